@@ -0,0 +1,176 @@
+/**
+ * @file
+ * @brief Reader for large files of puzzles, one puzzle per line.
+ *
+ * Regular files are memory mapped and parsed in place: the puzzles handed out
+ * are pointers straight into the mapping, so nothing is copied and no line is
+ * ever NUL terminated.  Only the first 81 characters of a puzzle are
+ * meaningful, which is all sudoku_solve and friends read.  Lines shorter than
+ * 81 characters (blank lines, comments) are skipped, and anything after the
+ * 81st character of a line is ignored.
+ *
+ * Input that cannot be mapped (stdin, pipes) falls back to reading
+ * CORPUS_BUFSIZE chunks into a buffer; puzzles then point into the buffer and
+ * stay valid only until the next call on the corpus.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "corpus.h"
+
+/**
+ * @brief Open the corpus at path, or stdin if path is NULL or "-".
+ * @return 0 on success, -1 on failure
+ */
+int corpus_open(corpus *cp, const char *path)
+{
+    struct stat st;
+    void *p;
+
+    cp->data = NULL;
+    cp->len = 0;
+    cp->pos = 0;
+    cp->mapped = 0;
+    cp->eof = 0;
+    cp->buf = NULL;
+
+    if (path == NULL || strcmp(path, "-") == 0)
+        cp->fd = STDIN_FILENO;
+    else if ((cp->fd = open(path, O_RDONLY)) < 0)
+        return -1;
+
+    if (fstat(cp->fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        cp->mapped = 1;
+        if (st.st_size == 0)    /* mmap refuses empty files */
+            return 0;
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, cp->fd, 0);
+        if (p != MAP_FAILED) {
+            posix_madvise(p, st.st_size, POSIX_MADV_SEQUENTIAL);
+            cp->data = p;
+            cp->len = st.st_size;
+            return 0;
+        }
+        cp->mapped = 0;
+    }
+
+    /* not mappable: fall back to buffered reads */
+    if ((cp->buf = malloc(CORPUS_BUFSIZE)) == NULL) {
+        corpus_close(cp);
+        return -1;
+    }
+    cp->data = cp->buf;
+    return 0;
+}
+
+/**
+ * @brief Move the unparsed tail of the buffer to the front and read as much
+ * as fits after it.
+ * @return number of bytes read, 0 at end of file or on error
+ */
+static size_t refill(corpus *cp)
+{
+    size_t n = cp->len - cp->pos;
+    ssize_t r;
+
+    memmove(cp->buf, cp->buf + cp->pos, n);
+    cp->pos = 0;
+    cp->len = n;
+    while (cp->len < CORPUS_BUFSIZE) {
+        r = read(cp->fd, cp->buf + cp->len, CORPUS_BUFSIZE - cp->len);
+        if (r <= 0) {
+            cp->eof = 1;
+            break;
+        }
+        cp->len += r;
+    }
+    return cp->len - n;
+}
+
+/**
+ * @brief Find the next puzzle in the data that is already in memory.
+ *
+ * A line without a newline at the end of the data only counts if no more
+ * data can follow it.
+ *
+ * @return pointer to the puzzle, or NULL if there is no complete line left
+ */
+static const char *next_line(corpus *cp)
+{
+    const char *p, *nl;
+    size_t left;
+
+    while (cp->pos < cp->len) {
+        p = cp->data + cp->pos;
+        left = cp->len - cp->pos;
+        if ((nl = memchr(p, '\n', left)) == NULL) {
+            /* partial line, wait for more data unless there is no more or
+             * the line alone fills the whole buffer */
+            if (!cp->mapped && !cp->eof && left < CORPUS_BUFSIZE)
+                return NULL;
+            nl = p + left;
+        }
+        cp->pos = nl - cp->data + (nl < p + left);
+        if (nl - p >= 81)
+            return p;
+    }
+    return NULL;
+}
+
+/**
+ * @return pointer to the next 81 character puzzle, or NULL at end of input.
+ *         The puzzle is not NUL terminated.
+ */
+const char *corpus_next(corpus *cp)
+{
+    const char *p;
+
+    while ((p = next_line(cp)) == NULL) {
+        if (cp->mapped || (refill(cp) == 0 && cp->pos == cp->len))
+            return NULL;
+    }
+    return p;
+}
+
+/**
+ * @brief Fill puzzles[] with up to n puzzles that lie contiguously in memory,
+ * for handing a whole batch to a solver at once.
+ *
+ * With buffered input, the slice ends early rather than straddling a refill,
+ * so every pointer in it stays valid until the next call on cp.
+ *
+ * @return number of puzzles in the slice, 0 at end of input
+ */
+size_t corpus_next_slice(corpus *cp, const char *puzzles[], size_t n)
+{
+    size_t i = 0;
+    const char *p;
+
+    if (n == 0)
+        return 0;
+
+    if ((p = corpus_next(cp)) == NULL)
+        return 0;
+    puzzles[i++] = p;
+
+    while (i < n && (p = next_line(cp)) != NULL)
+        puzzles[i++] = p;
+    return i;
+}
+
+/** @brief Release the mapping or buffer and close the input. */
+void corpus_close(corpus *cp)
+{
+    if (cp->mapped && cp->data != NULL)
+        munmap((void *) cp->data, cp->len);
+    free(cp->buf);
+    if (cp->fd != STDIN_FILENO && cp->fd >= 0)
+        close(cp->fd);
+    cp->data = cp->buf = NULL;
+    cp->len = cp->pos = 0;
+    cp->fd = -1;
+}
@@ -7,8 +7,24 @@
  * All algorithms taken straight out of Knuth's DLX paper, translated fairly
  * literally into C.
  */
+#include <string.h>
+#include <math.h>
 #include "dlx.h"
 
+/* On a matrix much bigger than the cache, cover() and uncover() wait on
+ * memory for the neighbours and header of each node they unlink.  Built
+ * with -D DLX_PREFETCH they ask for those of the next node while they
+ * update the current one, and for the next row before they walk this one.
+ * The extra loads cost more than they save when the matrix fits in cache,
+ * as sudoku and most benchmark problems do, so the hints are off unless
+ * asked for; "make bench" shows which way it goes.
+ */
+#if defined(__GNUC__) && defined(DLX_PREFETCH)
+#define PREFETCH(p)     __builtin_prefetch(p, 1)
+#else
+#define PREFETCH(p)     ((void) 0)
+#endif
+
 /* Summary of fundamental idea behind Knuth's DLX algorithm:
  * (1) Remove x from list:
  *      x->left->right = x->right;
@@ -60,6 +76,12 @@ static int is_removed_ud(node *n)
     return n->up->down != n;
 }
 
+/** @return 1 if node has been removed from its left-right list, 0 otherwise */
+static int is_removed_lr(node *n)
+{
+    return n->left->right != n;
+}
+
 /**
  * @brief Insert new node n into bottom of column c. 
  *
@@ -101,8 +123,12 @@ static void cover(hnode *chead)
 
     i = c;
     while ((i = i->down) != c) {    /* for each row, except c */
+        PREFETCH(i->down->right);
         j = i;
         while ((j = j->right) != i) {   /* for each node except i */
+            PREFETCH(j->right->up);
+            PREFETCH(j->right->down);
+            PREFETCH(j->right->chead);
             remove_ud(j);
             (j->chead->s)--;            /* update column node count */
         }
@@ -124,8 +150,12 @@ static void uncover(hnode *chead)
     /* all loops must traverse in opposite order from cover() */
     i = c;
     while ((i = i->up) != c) {      /* for each row except c */
+        PREFETCH(i->up->left);
         j = i;
         while ((j = j->left) != i) {    /* for each node except i */
+            PREFETCH(j->left->up);
+            PREFETCH(j->left->down);
+            PREFETCH(j->left->chead);
             (j->chead->s)++;            /* update column node count */
             insert_ud(j);
         }
@@ -342,6 +372,564 @@ size_t dlx_has_covers(hnode *root, size_t k)
 
 /** @} */
 
+/**
+ * @name GROUP_DLX_CTL
+ * Searches under a dlx_ctl.  A budget of search nodes and a stop flag that
+ * another thread may set bound how long any one search can take.
+ *
+ * The plain search always takes the first of the smallest columns and tries
+ * its rows top to bottom, so a matrix that sends it down a bad path does so
+ * every time.  With a seed, ties between smallest columns are broken at
+ * random, and each column's rows are tried going round from a random one.  A
+ * run that uses up its limit of search nodes is abandoned and the search
+ * restarts with fresh random choices, the limits following the Luby sequence
+ * 1, 1, 2, 1, 1, 2, 4, ... times ctl->restart, which keeps growing, so the
+ * search still ends.
+ * @{
+ */
+
+/** @brief State of one run of dlx_exact_cover_ctl or dlx_has_covers_ctl. */
+typedef struct {
+    node            **solution;
+    hnode           *root;
+    dlx_ctl         *ctl;
+    unsigned long   rng;        /**< xorshift state, 0 for the usual order */
+    unsigned long   limit;      /**< nodes allowed in this run, 0 for any */
+    unsigned long   nodes;      /**< nodes visited in this run */
+    int             gave_up;    /**< 0, RUN_RESTART or RUN_EXHAUSTED */
+} ctl_run;
+
+#define RUN_RESTART     1       /* over this run's limit: start again */
+#define RUN_EXHAUSTED   2       /* over ctl->budget, or stopped: give up */
+
+/** @brief Step the 32-bit xorshift generator at *x, which must not be 0 */
+static unsigned long next_random(unsigned long *x)
+{
+    unsigned long v = *x;
+
+    v ^= (v << 13) & 0xffffffffUL;
+    v ^= v >> 17;
+    v ^= (v << 5) & 0xffffffffUL;
+    return *x = v;
+}
+
+/** @return i-th term, counting from 1, of the Luby sequence */
+static unsigned long luby(unsigned long i)
+{
+    unsigned long k;
+
+    for (;;) {
+        for (k = 1; (1ul << k) - 1 < i; k++)
+            ;
+        if ((1ul << k) - 1 == i)
+            return 1ul << (k - 1);
+        i -= (1ul << (k - 1)) - 1;
+    }
+}
+
+/**
+ * @return like min_hnode_s, but a column chosen uniformly at random among
+ *          those with the smallest s field
+ */
+static hnode *random_min_hnode_s(hnode *root, unsigned long *rng)
+{
+    size_t n, ties = 0;
+    size_t min = -1u;
+    node *h = (node *) root;
+    node *i = h;
+    node *c = NULL;
+
+    while ((i = i->right) != h) {
+        n = ((hnode *) i)->s;
+        if (n < min) {
+            min  = n;
+            c    = i;
+            ties = 1;
+        } else if (n == min && next_random(rng) % ++ties == 0) {
+            c = i;      /* keeps each of the ties with probability 1/ties */
+        }
+    }
+    return (hnode *) c;
+}
+
+/**
+ * @brief Count a search node against the run's limit and ctl's budget, and
+ * check the stop flag.
+ * @return 1 if the search must give up, with run->gave_up set to say why
+ */
+static int out_of_budget(ctl_run *run)
+{
+    dlx_ctl *ctl = run->ctl;
+
+    if ((ctl->budget != 0 && ctl->nodes >= ctl->budget)
+            || (ctl->stop != NULL && *ctl->stop)) {
+        run->gave_up = RUN_EXHAUSTED;
+    } else if (run->limit != 0 && run->nodes >= run->limit) {
+        run->gave_up = RUN_RESTART;
+    } else {
+        ctl->nodes++;
+        run->nodes++;
+    }
+    return run->gave_up != 0;
+}
+
+/** @brief dlx_exact_cover, giving up when the run is over budget or stopped */
+static size_t ctl_search(ctl_run *run, size_t k)
+{
+    size_t n, s, t;
+    node *i, *j, *cn;
+    hnode *c;
+    node *h = (node *) run->root;
+
+    if (h->right == h)
+        return k;
+
+    if (out_of_budget(run))
+        return 0;
+
+    c = run->rng ? random_min_hnode_s(run->root, &run->rng)
+                 : min_hnode_s(run->root);
+    cover(c);
+
+    cn = (node *) c;
+    n = 0;
+
+    /* go round the column once, starting at a random row; c's rows stay
+     * linked to it while it is covered */
+    s = c->s;
+    i = cn->down;
+    if (run->rng && s > 1)
+        for (t = next_random(&run->rng) % s; t > 0; t--)
+            i = i->down;
+
+    for (t = 0; t < s; t++) {
+        run->solution[k] = i;
+
+        j = i;
+        while ((j = j->right) != i)
+            cover(j->chead);
+
+        n = ctl_search(run, k + 1);
+
+        j = i;
+        while ((j = j->left) != i)
+            uncover(j->chead);
+
+        if (n > 0 || run->gave_up)
+            break;
+        if ((i = i->down) == cn)
+            i = cn->down;
+    }
+
+    uncover(c);
+    return n;
+}
+
+/** @brief dlx_has_covers, giving up when over budget or stopped */
+static size_t ctl_count(ctl_run *run, size_t k)
+{
+    node *i, *j, *cn;
+    hnode *c;
+    node *h = (node *) run->root;
+
+    if (h->right == h)
+        return k - 1;
+    if (out_of_budget(run))
+        return k;
+
+    c = min_hnode_s(run->root);
+    cover(c);
+
+    cn = (node *) c;
+    i = cn;
+    while ((i = i->down) != cn) {
+        j = i;
+        while ((j = j->right) != i)
+            cover(j->chead);
+
+        k = ctl_count(run, k);
+
+        j = i;
+        while ((j = j->left) != i)
+            uncover(j->chead);
+
+        if (k == 0 || run->gave_up)
+            break;
+    }
+
+    uncover(c);
+    return k;
+}
+
+/** @brief Set up ctl for the plain search with no limits; zero its counts */
+void dlx_ctl_init(dlx_ctl *ctl)
+{
+    ctl->seed     = 0;
+    ctl->restart  = 0;
+    ctl->budget   = 0;
+    ctl->stop     = NULL;
+    ctl->nodes    = 0;
+    ctl->restarts = 0;
+}
+
+/**
+ * @brief dlx_exact_cover with the randomisation, restarts, budget and stop
+ * flag set in ctl.  ctl->nodes and ctl->restarts are added to.
+ *
+ * On DLX_EXHAUSTED the matrix is restored as after any other search, and
+ * nothing is known about whether a solution exists.
+ *
+ * @return 0 if no solution, size of solution otherwise, or DLX_EXHAUSTED if
+ *          ctl->nodes reached ctl->budget or *ctl->stop was set first
+ */
+size_t dlx_exact_cover_ctl(node *solution[], hnode *root, dlx_ctl *ctl)
+{
+    ctl_run run;
+    unsigned long i;
+    size_t n;
+
+    run.solution = solution;
+    run.root     = root;
+    run.ctl      = ctl;
+    run.rng      = ctl->seed & 0xffffffffUL;
+    if (ctl->seed != 0 && run.rng == 0)
+        run.rng = 0x9e3779b9UL;
+
+    for (i = 1; ; i++) {
+        run.limit   = run.rng && ctl->restart ? ctl->restart * luby(i) : 0;
+        run.nodes   = 0;
+        run.gave_up = 0;
+        n = ctl_search(&run, 0);
+        if (run.gave_up == RUN_EXHAUSTED)
+            return DLX_EXHAUSTED;
+        if (run.gave_up == 0)
+            return n;
+        ctl->restarts++;
+    }
+}
+
+/**
+ * @brief dlx_has_covers under the budget and stop flag in ctl; the order of
+ * the search does not change the count, so the seed and restart members are
+ * not used.  ctl->nodes is added to.
+ *
+ * @param k     max number of solutions to find
+ * @return (k - n) like dlx_has_covers, or DLX_EXHAUSTED if ctl->nodes reached
+ *          ctl->budget or *ctl->stop was set first
+ */
+size_t dlx_has_covers_ctl(hnode *root, size_t k, dlx_ctl *ctl)
+{
+    ctl_run run;
+
+    run.solution = NULL;
+    run.root     = root;
+    run.ctl      = ctl;
+    run.rng      = 0;
+    run.limit    = 0;
+    run.nodes    = 0;
+    run.gave_up  = 0;
+    k = ctl_count(&run, k);
+    return run.gave_up ? DLX_EXHAUSTED : k;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_ESTIMATE
+ * Knuth's Monte Carlo estimate of the size of a backtrack tree ("Estimating
+ * the efficiency of backtrack programs", 1975).  A probe walks from the root
+ * to a leaf, choosing columns the way the search does but only one row at
+ * each level, uniformly at random.  If the columns chosen had d1, d2, ...
+ * rows, then 1 + d1 + d1 d2 + ... is an unbiased estimate of the number of
+ * nodes in the tree, and d1 d2 ... dk, if the probe ends at a solution, an
+ * unbiased estimate of the number of solutions.  Averaging many probes
+ * narrows the estimates down; the tree is often heavy tailed, so a probe
+ * count in the thousands is not unusual.
+ * @{
+ */
+
+/** @brief Sums kept over the probes of one dlx_estimate. */
+typedef struct {
+    hnode           *root;
+    unsigned long   rng;
+    unsigned long   steps;      /**< levels walked by this probe */
+    double          nodes;      /**< this probe's node estimate */
+    double          solutions;  /**< this probe's solution estimate */
+} estimate_probe;
+
+/** @brief Walk one random path down from the current matrix. */
+static void probe(estimate_probe *p, double weight)
+{
+    size_t s, t;
+    node *i, *j, *cn;
+    hnode *c;
+    node *h = (node *) p->root;
+
+    if (h->right == h) {
+        p->solutions = weight;
+        return;
+    }
+    p->nodes += weight;
+    p->steps++;
+
+    c = min_hnode_s(p->root);
+    if ((s = c->s) == 0)
+        return;
+    cover(c);
+
+    cn = (node *) c;
+    i = cn->down;
+    for (t = next_random(&p->rng) % s; t > 0; t--)
+        i = i->down;
+
+    j = i;
+    while ((j = j->right) != i)
+        cover(j->chead);
+
+    probe(p, weight * s);
+
+    j = i;
+    while ((j = j->left) != i)
+        uncover(j->chead);
+
+    uncover(c);
+}
+
+/** @brief Add x to a running mean and sum of squared deviations (Welford) */
+static void accumulate(double *mean, double *m2, unsigned long n, double x)
+{
+    double d = x - *mean;
+
+    *mean += d / n;
+    *m2   += d * (x - *mean);
+}
+
+/** @return half width of the 95% confidence interval for a mean of n samples */
+static double confidence(double m2, unsigned long n)
+{
+    if (n < 2)
+        return HUGE_VAL;
+    return 1.96 * sqrt(m2 / (n - 1) / n);
+}
+
+/**
+ * @brief Estimate the number of exact covers of root, and the number of
+ * nodes a full count with dlx_has_covers_ctl would visit, from random probes.
+ *
+ * The seed comes from ctl->seed (any seed, 0 included, gives a random walk),
+ * and probes stop early if ctl->budget or *ctl->stop says so; ctl->nodes is
+ * added to with the levels walked.  ctl->restart is not used.  The matrix is
+ * restored on return.
+ *
+ * @param probes    number of probes to make
+ * @param est       gets the estimates, with 95% confidence intervals
+ */
+void dlx_estimate(hnode *root, unsigned long probes, dlx_ctl *ctl,
+                  dlx_est *est)
+{
+    estimate_probe p;
+    double m2_nodes = 0, m2_solutions = 0;
+
+    p.root = root;
+    p.rng  = ctl->seed & 0xffffffffUL;
+    if (p.rng == 0)
+        p.rng = 0x9e3779b9UL;
+
+    est->probes    = 0;
+    est->nodes     = 0;
+    est->solutions = 0;
+    while (est->probes < probes
+            && (ctl->budget == 0 || ctl->nodes < ctl->budget)
+            && (ctl->stop == NULL || !*ctl->stop)) {
+        p.steps     = 0;
+        p.nodes     = 0;
+        p.solutions = 0;
+        probe(&p, 1);
+        ctl->nodes += p.steps;
+
+        est->probes++;
+        accumulate(&est->nodes, &m2_nodes, est->probes, p.nodes);
+        accumulate(&est->solutions, &m2_solutions, est->probes, p.solutions);
+    }
+    est->nodes_ci     = confidence(m2_nodes, est->probes);
+    est->solutions_ci = confidence(m2_solutions, est->probes);
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_SYMMETRY
+ * Counting covers up to symmetry.  Tiling problems in particular have
+ * symmetries, permutations of the rows and columns that map the matrix onto
+ * itself and so map covers to covers, and a plain count finds every cover
+ * once for each of its images.  If a column c is mapped to itself by every
+ * symmetry, the symmetries split c's rows into orbits, and for rows r and
+ * g(r) of one orbit, g maps the covers that use r one to one onto those that
+ * use g(r).  Every cover uses exactly one row of c, so the number of covers
+ * is the sum over the orbits of the orbit's size times the number of covers
+ * that use one row picked from it; only the picked rows need searching.
+ * With a column whose rows mostly lie in orbits as large as the group (say,
+ * the placements of an asymmetric pentomino), this divides the work by about
+ * the number of symmetries.
+ * @{
+ */
+
+/**
+ * @brief Count all exact covers of root, searching under one row of each
+ * orbit of sym->column only.
+ *
+ * Runs under ctl's budget and stop flag like dlx_has_covers_ctl, and adds to
+ * ctl->nodes.  The matrix is restored on return.
+ *
+ * @param sym   the column, which must not be covered, and the orbit hook
+ * @return number of exact covers, or DLX_EXHAUSTED if ctl->nodes reached
+ *          ctl->budget or *ctl->stop was set first
+ */
+size_t dlx_count_sym(hnode *root, const dlx_sym *sym, dlx_ctl *ctl)
+{
+    const size_t all = DLX_EXHAUSTED - 1;
+    unsigned long w;
+    size_t n, total = 0;
+    node *i, *j;
+    node *cn = (node *) sym->column;
+
+    cover(sym->column);
+
+    i = cn;
+    while ((i = i->down) != cn) {
+        if ((w = sym->orbit(i, sym->arg)) == 0)
+            continue;
+
+        j = i;
+        while ((j = j->right) != i)
+            cover(j->chead);
+
+        n = dlx_has_covers_ctl(root, all, ctl);
+
+        j = i;
+        while ((j = j->left) != i)
+            uncover(j->chead);
+
+        if (n == DLX_EXHAUSTED) {
+            total = DLX_EXHAUSTED;
+            break;
+        }
+        total += w * (all - n);
+    }
+
+    uncover(sym->column);
+    return total;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_ITER
+ * dlx_exact_cover turned inside out: the recursion stack becomes the rows[]
+ * array, so the search can stop at each solution, hand it to the caller, and
+ * pick up where it left off on the next call.  Level k's column is not stored
+ * separately; it is always rows[k]->chead.
+ * @{
+ */
+
+/**
+ * @brief Start an enumeration of the exact covers of root.
+ *
+ * @param rows  storage for one row per level of the search; max must be at
+ *              least the number of columns left in root, which bounds the
+ *              size of any solution
+ */
+void dlx_iter_init(dlx_iter *it, hnode *root, node *rows[], size_t max)
+{
+    it->root  = root;
+    it->rows  = rows;
+    it->max   = max;
+    it->k     = 0;
+    it->state = DLX_ITER_START;
+}
+
+/**
+ * @brief Advance to the next solution.
+ *
+ * While a solution is being looked at, the matrix is left covered; it is
+ * restored once dlx_iter_next runs out of solutions, or by dlx_iter_abort.
+ *
+ * @return 1 if another solution was found, in it->rows[0 .. it->k - 1]; 0 if
+ *          there are no more
+ */
+int dlx_iter_next(dlx_iter *it)
+{
+    node *i, *j;
+    hnode *c;
+    node *h = (node *) it->root;
+    int descend = it->state == DLX_ITER_START;
+
+    if (it->state == DLX_ITER_DONE)
+        return 0;
+
+    for (;;) {
+        if (descend) {
+            /* if array has no columns left, we are at a solution */
+            if (h->right == h) {
+                it->state = DLX_ITER_FOUND;
+                return 1;
+            }
+            if (it->k == it->max) {     /* out of room: treat as dead end */
+                descend = 0;
+                continue;
+            }
+            c = min_hnode_s(it->root);
+            cover(c);
+            i = ((node *) c)->down;
+        } else {
+            /* backtrack: undo the row at the previous level, try the next */
+            if (it->k == 0) {
+                it->state = DLX_ITER_DONE;
+                return 0;
+            }
+            i = it->rows[--it->k];
+            c = i->chead;
+            j = i;
+            while ((j = j->left) != i)
+                uncover(j->chead);
+            i = i->down;
+        }
+
+        if (i == (node *) c) {      /* no rows left in column c */
+            uncover(c);
+            descend = 0;
+            continue;
+        }
+
+        /* guess row i and cover all of the other columns in it */
+        it->rows[it->k++] = i;
+        j = i;
+        while ((j = j->right) != i)
+            cover(j->chead);
+        descend = 1;
+    }
+}
+
+/**
+ * @brief Stop an enumeration early, restoring the matrix.  Does nothing if
+ * the enumeration has already finished.
+ */
+void dlx_iter_abort(dlx_iter *it)
+{
+    node *i, *j;
+
+    while (it->k > 0) {
+        i = it->rows[--it->k];
+        j = i;
+        while ((j = j->left) != i)
+            uncover(j->chead);
+        uncover(i->chead);
+    }
+    it->state = DLX_ITER_DONE;
+}
+
+/** @} */
+
 /**
  * @name GROUP_DLX_FORCE_ROWS
  * Utility functions to force a certain row to be part of the solution (e.g.
@@ -377,12 +965,15 @@ int dlx_force_row(node *r)
  * @brief Undo dlx_force_row.  Must be called in exact reverse order as
  * dlx_force_row for links to be restored properly.
  *
- * @return 0 on success, -1 if r is still in the matrix.
+ * @return 0 on success, -1 if r has not been selected.
  */
 int dlx_unselect_row(node *r)
 {
     node *i = r;
-    if (!is_removed_ud(r))
+
+    /* covering r->chead first leaves r itself linked into its column, so
+     * check the column header instead of r */
+    if (!is_removed_lr((node *) r->chead))
         return -1;
 
     /* reverse order of dlx_force_row; uncover all of r's columns, finishing
@@ -393,8 +984,314 @@ int dlx_unselect_row(node *r)
     return 0;
 }
 
+/**
+ * @brief Force the only row left in every column with s == 1, until no such
+ * column is left, without branching.
+ *
+ * Each forced row is appended to rows[] in the order it was forced; undo them
+ * by calling dlx_unselect_row on rows[*n - 1] back down to the first row
+ * forced, whether or not a contradiction was found.  The node stored is the
+ * one in the s == 1 column, so rows[i]->chead is the column that forced it.
+ *
+ * @param n     number of rows already in rows[]; incremented for each row
+ *              forced
+ * @param max   capacity of rows; propagation stops early when it is full
+ * @return 0 on success, -1 if a column with no rows left was found, meaning
+ *          there is no solution
+ */
+int dlx_propagate(hnode *root, node *rows[], size_t *n, size_t max)
+{
+    node *h = (node *) root;
+    node *c = h->right;
+
+    while (c != h) {
+        if (((hnode *) c)->s == 0)
+            return -1;
+        if (((hnode *) c)->s == 1 && *n < max) {
+            rows[(*n)++] = c->down;
+            dlx_force_row(c->down);
+            /* the columns already passed may be down to 0 or 1 rows now,
+             * and c->right may have been covered too: start over */
+            c = h->right;
+        } else {
+            c = c->right;
+        }
+    }
+    return 0;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_VERIFY
+ * Consistency checks for testing and debugging.
+ * @{
+ */
+
+/**
+ * @brief Check the links of every node that is still reachable from root.
+ *
+ * Every column left in the header list must be doubly linked into it, every
+ * node in such a column must be doubly linked into the column and point back
+ * at its header, the header's s must equal the number of nodes in the column,
+ * and every row those nodes belong to must be doubly linked left-right (row
+ * links are never changed by the search, so this holds in covered rows too).
+ *
+ * @return 0 if the matrix is consistent, -1 at the first inconsistency found
+ */
+int dlx_verify_links(hnode *root)
+{
+    node *h = (node *) root;
+    node *c, *i, *j;
+    size_t n;
+
+    for (c = h->right; c != h; c = c->right) {
+        if (c->right->left != c || c->left->right != c)
+            return -1;
+
+        n = 0;
+        for (i = c->down; i != c; i = i->down) {
+            if (i->down->up != i || i->up->down != i
+                    || i->chead != (hnode *) c)
+                return -1;
+            j = i;
+            do {
+                if (j->right->left != j || j->left->right != j)
+                    return -1;
+            } while ((j = j->right) != i);
+            n++;
+        }
+        if (n != ((hnode *) c)->s)
+            return -1;
+    }
+    return 0;
+}
+
+/** @brief Record x in snap[*n] if there is room, and count it either way */
+static void snap_node(dlx_snap snap[], size_t max, size_t *n, node *x,
+                      size_t s)
+{
+    if (*n < max) {
+        snap[*n].at    = x;
+        snap[*n].links = *x;
+        snap[*n].s     = s;
+    }
+    (*n)++;
+}
+
+/** @return 1 if x no longer matches the snapshot entry e */
+static int snap_differs(const dlx_snap *e, node *x, size_t s)
+{
+    return e->at != x || e->s != s
+        || memcmp(&e->links, x, sizeof(*x)) != 0;
+}
+
+/**
+ * @brief Take a snapshot of everything reachable from root: the root, the
+ * column headers in header list order, and each column's nodes in order.
+ *
+ * Call with max = 0 (snap may then be NULL) to find out how many entries are
+ * needed.
+ *
+ * @return number of entries in the full snapshot; only the first max are
+ *          written
+ */
+size_t dlx_snapshot(hnode *root, dlx_snap snap[], size_t max)
+{
+    node *h = (node *) root;
+    node *c, *i;
+    size_t n = 0;
+
+    snap_node(snap, max, &n, h, root->s);
+    for (c = h->right; c != h; c = c->right) {
+        snap_node(snap, max, &n, c, ((hnode *) c)->s);
+        for (i = c->down; i != c; i = i->down)
+            snap_node(snap, max, &n, i, 0);
+    }
+    return n;
+}
+
+/**
+ * @brief Check the matrix with dlx_verify_links, and if snap is not NULL,
+ * also check that it is exactly as it was when the n entry snapshot in snap
+ * was taken: the same headers and nodes in the same order, with the same
+ * links and counts.
+ *
+ * The usual pattern is to take a snapshot before a search and verify against
+ * it afterwards; a search, or a series of dlx_force_row calls undone by
+ * dlx_unselect_row in LIFO order, must leave no trace.
+ *
+ * @return 0 if the matrix is consistent (and matches snap), -1 otherwise
+ */
+int dlx_verify(hnode *root, const dlx_snap snap[], size_t n)
+{
+    node *h = (node *) root;
+    node *c, *i;
+    size_t k = 0;
+
+    if (dlx_verify_links(root) != 0)
+        return -1;
+    if (snap == NULL)
+        return 0;
+
+    if (n == 0 || snap_differs(snap + k++, h, root->s))
+        return -1;
+    for (c = h->right; c != h; c = c->right) {
+        if (k == n || snap_differs(snap + k++, c, ((hnode *) c)->s))
+            return -1;
+        for (i = c->down; i != c; i = i->down)
+            if (k == n || snap_differs(snap + k++, i, 0))
+                return -1;
+    }
+    return k == n ? 0 : -1;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_LAYOUT
+ * Where the nodes of a matrix sit in memory.  Both functions walk every
+ * column on the header list, and every row through it, so every row must
+ * have a node in such a column, and nothing may be covered.  A row belongs
+ * to the column of its node with the lowest address among those.
+ * @{
+ */
+
+/** the cache dlx_layout_stats models: 32 KiB, 8 way, like most L1s */
+#define LAYOUT_LINE     64
+#define LAYOUT_SETS     64
+#define LAYOUT_WAYS     8
+
+/** @return 1 if row node i is the one its row belongs to the column of */
+static int row_owner(node *i)
+{
+    node *j = i;
+
+    while ((j = j->right) != i)
+        if (j < i && j->chead->base_node.right != (node *) j->chead)
+            return 0;
+    return 1;
+}
+
+/**
+ * @brief Read x through the model cache, each set of which holds its tags
+ * most recently used first, and count a miss if it was not there.
+ */
+static void touch(size_t tags[][LAYOUT_WAYS], const void *x, dlx_layout *l)
+{
+    size_t line = (size_t) x / LAYOUT_LINE + 1;
+    size_t *set = tags[line % LAYOUT_SETS];
+    int w;
+
+    l->reads++;
+    for (w = 0; w < LAYOUT_WAYS - 1 && set[w] != line; w++)
+        ;
+    if (set[w] != line)
+        l->misses++;
+    for (; w > 0; w--)
+        set[w] = set[w - 1];
+    set[0] = line;
+}
+
+/**
+ * @brief Count the nodes reachable from root, and estimate how well they
+ * sit in the cache: replay the reads cover() makes for each column in turn,
+ * on the full matrix, through a model cache that starts empty.
+ */
+void dlx_layout_stats(hnode *root, dlx_layout *l)
+{
+    size_t tags[LAYOUT_SETS][LAYOUT_WAYS];
+    node *h = (node *) root;
+    node *c, *i, *j;
+    int owner;
+
+    memset(tags, 0, sizeof(tags));
+    l->nodes  = 0;
+    l->reads  = 0;
+    l->misses = 0;
+    for (c = h->right; c != h; c = c->right) {
+        touch(tags, c, l);
+        for (i = c->down; i != c; i = i->down) {
+            touch(tags, i, l);
+            owner = row_owner(i);
+            l->nodes += owner;
+            for (j = i->right; j != i; j = j->right) {
+                l->nodes += owner;
+                touch(tags, j, l);
+                touch(tags, j->up, l);
+                touch(tags, j->down, l);
+                touch(tags, j->chead, l);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Move every node reachable from root into arena, in traversal order:
+ * the rows of each column on the header list in turn, each row's nodes
+ * together and in order, starting from the one at the lowest address.  The
+ * headers stay where they are.
+ *
+ * The old nodes are left out of the matrix; the left link of each points at
+ * its copy, so that pointers into the old nodes can be translated, and
+ * nothing else in them is meaningful.  Freeing them is up to the caller.
+ *
+ * @param arena room for as many nodes as dlx_layout_stats counts
+ * @return number of nodes moved
+ */
+size_t dlx_compact(hnode *root, node arena[])
+{
+    node *h = (node *) root;
+    node *c, *i, *j, *first;
+    size_t k, n = 0;
+
+    /* copy each row, leaving a forwarding pointer in the left link of the
+     * old node; this pass reads only the down, right and chead links */
+    for (c = h->right; c != h; c = c->right) {
+        for (i = c->down; i != c; i = i->down) {
+            if (!row_owner(i))
+                continue;
+            first = j = i;
+            while ((j = j->right) != i)
+                if (j < first)
+                    first = j;
+            j = first;
+            do {
+                arena[n] = *j;
+                j->left = arena + n++;
+            } while ((j = j->right) != first);
+        }
+    }
+
+    /* point the copies, and the ends of each column, at the copies */
+    for (k = 0; k < n; k++) {
+        j = arena + k;
+        c = (node *) j->chead;
+        j->left  = j->left->left;
+        j->right = j->right->left;
+        if (j->up == c)
+            c->down = j;
+        else
+            j->up = j->up->left;
+        if (j->down == c)
+            c->up = j;
+        else
+            j->down = j->down->left;
+    }
+    return n;
+}
+
 /** @} */
 
+/**
+ * @return DLX_VERSION of the library actually linked in, to check against the
+ * headers a program was built with
+ */
+const char *dlx_version(void)
+{
+    return DLX_VERSION;
+}
+
 /**
  * @name GROUP_MATRIX_INIT_UTILS
  * Utility functions to aid in setting up node links when constructing a DLX
@@ -473,36 +1370,21 @@ hnode *dlx_make_headers(hnode *root, hnode *headers, size_t n)
  * @param nodes     contiguous, pre-allocated node block of size n
  * @param headers   contiguous, pre-initialized column headers array
  * @param cols      int[n] containg column indices in increasing order
- * @param n     number of nodes per row in nodes
+ * @param n     number of nodes per row in nodes, at least 1
  */
 void dlx_make_row(node *nodes, hnode *headers, int cols[], size_t n)
 {
     size_t i;
     node *ni;
 
-    ni = nodes;
-
-    /* first node */
-    ni->left  = ni + n - 1;
-    ni->right = ni + 1;
-    column_append_node(headers + cols[0], ni);
-    (ni->chead->s)++;
-
-    ni++;
-
-    /* from 2nd node to 2nd from last node */
-    for (i = 1; i < n - 1; i++, ni++) {
-        ni->left    = ni - 1;
-        ni->right   = ni + 1;
+    /* the first node's left and the last node's right wrap around, which
+     * for a single node is the node itself */
+    for (i = 0, ni = nodes; i < n; i++, ni++) {
+        ni->left    = i > 0 ? ni - 1 : nodes + n - 1;
+        ni->right   = i < n - 1 ? ni + 1 : nodes;
         column_append_node(headers + cols[i], ni);
         (ni->chead->s)++;
     }
-
-    /* last node */
-    ni->left  = ni - 1;
-    ni->right = nodes;
-    column_append_node(headers + cols[n - 1], ni);
-    (ni->chead->s)++;
 }
 
 /** @} */
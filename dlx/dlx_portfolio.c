@@ -0,0 +1,287 @@
+/**
+ * @file
+ * @brief Searches on several copies of a matrix at once, one thread each:
+ * a portfolio of seeds racing to find one cover, and a count of all covers
+ * split between the threads.
+ *
+ * Randomised DLX runtimes are heavy tailed: most seeds find a cover quickly,
+ * a few take far longer.  Racing n seeds and taking the first answer cuts off
+ * the tail.  The search changes the links of the matrix it works on, so each
+ * thread needs a matrix of its own; roots[t] must be identical copies (for
+ * example, from n calls to make_sparse with the same matrix).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "dlx.h"
+
+/** @brief What the threads of one dlx_portfolio call share. */
+typedef struct {
+    pthread_mutex_t lock;
+    volatile int    *stop;      /**< set by the first thread to finish */
+    size_t          winner;     /**< that thread, or n while none has */
+    size_t          n;
+} portfolio;
+
+/** @brief One thread's search. */
+typedef struct {
+    portfolio   *pf;
+    size_t      index;
+    hnode       *root;
+    node        **solution;
+    dlx_ctl     ctl;
+    size_t      k;              /**< what dlx_exact_cover_ctl returned */
+} worker;
+
+/** @brief Thread body: search, and claim the win if nobody has yet. */
+static void *run_worker(void *arg)
+{
+    worker      *w  = arg;
+    portfolio   *pf = w->pf;
+
+    w->k = dlx_exact_cover_ctl(w->solution, w->root, &w->ctl);
+
+    /* a search that ran to the end, with or without a cover, is an answer;
+     * one that ran out of budget or was stopped is not */
+    pthread_mutex_lock(&pf->lock);
+    if (pf->winner == pf->n && w->k != DLX_EXHAUSTED) {
+        pf->winner = w->index;
+        *pf->stop = 1;
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+/**
+ * @brief Race n threads, each running dlx_exact_cover_ctl on roots[t] with
+ * seed ctl->seed + t (so with a seed of 0, thread 0 is the usual
+ * deterministic search), and stop the others as soon as one finishes.
+ *
+ * If ctl->stop is not NULL, it is the flag the threads share: setting it
+ * stops them all, and the winner sets it when done.  ctl->budget applies to
+ * each thread separately, and every thread's node and restart counts are
+ * added to ctl.  All matrices are restored on return.
+ *
+ * @param solution  gets the winner's solution; its nodes belong to
+ *                  roots[*winner]
+ * @param max       capacity of solution; at least the number of columns
+ * @param n         number of threads and of copies in roots[], at least 1
+ * @param winner    set to the thread that answered, or to n if none did
+ * @return 0 if no solution, size of solution otherwise, or DLX_EXHAUSTED if
+ *          every thread ran out of budget or they were stopped
+ */
+size_t dlx_portfolio(node *solution[], size_t max, hnode *roots[], size_t n,
+                     dlx_ctl *ctl, size_t *winner)
+{
+    portfolio   pf;
+    worker      *w;
+    pthread_t   *threads;
+    node        **rows;
+    char        *started;
+    volatile int stop = 0;
+    size_t      t, k = DLX_EXHAUSTED;
+
+    w       = malloc(n * sizeof(*w));
+    threads = malloc(n * sizeof(*threads));
+    rows    = malloc(n * max * sizeof(*rows));
+    started = malloc(n);
+    if (w == NULL || threads == NULL || rows == NULL || started == NULL) {
+        free(w);
+        free(threads);
+        free(rows);
+        free(started);
+        *winner = 0;    /* no memory for threads: search alone */
+        return dlx_exact_cover_ctl(solution, roots[0], ctl);
+    }
+
+    pthread_mutex_init(&pf.lock, NULL);
+    pf.stop   = ctl->stop != NULL ? ctl->stop : &stop;
+    pf.winner = n;
+    pf.n      = n;
+
+    for (t = 0; t < n; t++) {
+        w[t].pf       = &pf;
+        w[t].index    = t;
+        w[t].root     = roots[t];
+        w[t].solution = rows + t * max;
+        w[t].k        = 0;
+        dlx_ctl_init(&w[t].ctl);
+        w[t].ctl.seed    = ctl->seed + t;
+        w[t].ctl.restart = ctl->restart;
+        w[t].ctl.budget  = ctl->budget;
+        w[t].ctl.stop    = pf.stop;
+    }
+
+    /* thread 0 runs in the caller's thread */
+    for (t = 1; t < n; t++)
+        started[t] = pthread_create(threads + t, NULL, run_worker, w + t) == 0;
+    run_worker(w);
+    for (t = 1; t < n; t++)
+        if (started[t])
+            pthread_join(threads[t], NULL);
+
+    for (t = 0; t < n; t++) {
+        ctl->nodes    += w[t].ctl.nodes;
+        ctl->restarts += w[t].ctl.restarts;
+    }
+    if ((*winner = pf.winner) < n) {
+        k = w[pf.winner].k;
+        memcpy(solution, w[pf.winner].solution, k * sizeof(*solution));
+    }
+
+    pthread_mutex_destroy(&pf.lock);
+    free(w);
+    free(threads);
+    free(rows);
+    free(started);
+    return k;
+}
+
+/**
+ * @name GROUP_DLX_PARALLEL_COUNT
+ * Counting covers in parallel.  The column the search would branch on first
+ * splits the tree into one subtree per row, and the subtrees are handed out
+ * one at a time to whichever thread is free, so a few big subtrees do not
+ * hold up the rest.  The copies are identical, so a column and a row are
+ * named by their place in the header list and in the column.
+ * @{
+ */
+
+/** @brief What the threads of one dlx_count_parallel call share. */
+typedef struct {
+    pthread_mutex_t lock;
+    volatile int    *stop;      /**< set when a thread runs out of budget */
+    size_t          position;   /**< the split column's place in the list */
+    size_t          rows;       /**< rows in the split column */
+    size_t          next;       /**< next row to hand out */
+    size_t          total;      /**< covers counted so far */
+    int             exhausted;  /**< a subtree was not counted */
+} split;
+
+/** @brief One thread's share of the count. */
+typedef struct {
+    split       *sp;
+    hnode       *root;
+    dlx_ctl     ctl;
+} counter;
+
+/** @brief Thread body: count subtrees until there are none left. */
+static void *run_counter(void *arg)
+{
+    counter *w  = arg;
+    split   *sp = w->sp;
+    node    *h  = (node *) w->root;
+    node    *c, *r;
+    size_t  i, k, n;
+    const size_t all = DLX_EXHAUSTED - 1;
+
+    for (c = h->right, i = 0; i < sp->position; i++)
+        c = c->right;
+
+    for (;;) {
+        pthread_mutex_lock(&sp->lock);
+        k = sp->exhausted ? sp->rows : sp->next++;
+        pthread_mutex_unlock(&sp->lock);
+        if (k >= sp->rows)
+            break;
+
+        for (r = c->down, i = 0; i < k; i++)
+            r = r->down;
+        dlx_force_row(r);
+        n = dlx_has_covers_ctl(w->root, all, &w->ctl);
+        dlx_unselect_row(r);
+
+        pthread_mutex_lock(&sp->lock);
+        if (n == DLX_EXHAUSTED) {
+            sp->exhausted = 1;
+            *sp->stop = 1;
+        } else {
+            sp->total += all - n;
+        }
+        pthread_mutex_unlock(&sp->lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Count all exact covers of roots[0], like dlx_has_covers_ctl with no
+ * limit on k, with n threads, each working on its own copy roots[t].
+ *
+ * ctl->budget applies to each thread separately, and ctl->stop, if not NULL,
+ * stops them all, and is set by the first thread to run out of budget.
+ * Every thread's node count is added to ctl->nodes.  All matrices are
+ * restored on return.
+ *
+ * @param n     number of threads and of copies in roots[], at least 1
+ * @return number of exact covers, or DLX_EXHAUSTED if any part of the count
+ *          was cut short
+ */
+size_t dlx_count_parallel(hnode *roots[], size_t n, dlx_ctl *ctl)
+{
+    split       sp;
+    counter     *w;
+    pthread_t   *threads;
+    char        *started;
+    volatile int stop = 0;
+    node        *h = (node *) roots[0];
+    node        *c, *min = NULL;
+    size_t      t;
+
+    if (h->right == h)
+        return 1;       /* nothing to cover: the empty cover */
+
+    /* the column dlx_has_covers would branch on, and its place */
+    sp.position = 0;
+    for (c = h->right, t = 0; c != h; c = c->right, t++) {
+        if (min == NULL || ((hnode *) c)->s < ((hnode *) min)->s) {
+            min = c;
+            sp.position = t;
+        }
+    }
+    sp.rows      = ((hnode *) min)->s;
+    sp.next      = 0;
+    sp.total     = 0;
+    sp.exhausted = 0;
+    sp.stop      = ctl->stop != NULL ? ctl->stop : &stop;
+
+    w       = malloc(n * sizeof(*w));
+    threads = malloc(n * sizeof(*threads));
+    started = malloc(n);
+    if (w == NULL || threads == NULL || started == NULL) {
+        free(w);
+        free(threads);
+        free(started);
+        /* no memory for threads: count alone */
+        t = dlx_has_covers_ctl(roots[0], DLX_EXHAUSTED - 1, ctl);
+        return t == DLX_EXHAUSTED ? t : DLX_EXHAUSTED - 1 - t;
+    }
+
+    pthread_mutex_init(&sp.lock, NULL);
+    for (t = 0; t < n; t++) {
+        w[t].sp   = &sp;
+        w[t].root = roots[t];
+        dlx_ctl_init(&w[t].ctl);
+        w[t].ctl.budget = ctl->budget;
+        w[t].ctl.stop   = sp.stop;
+    }
+
+    /* thread 0 runs in the caller's thread */
+    for (t = 1; t < n; t++)
+        started[t] = pthread_create(threads + t, NULL, run_counter, w + t) == 0;
+    run_counter(w);
+    for (t = 1; t < n; t++)
+        if (started[t])
+            pthread_join(threads[t], NULL);
+
+    for (t = 0; t < n; t++)
+        ctl->nodes += w[t].ctl.nodes;
+
+    pthread_mutex_destroy(&sp.lock);
+    free(w);
+    free(threads);
+    free(started);
+    return sp.exhausted ? DLX_EXHAUSTED : sp.total;
+}
+
+/** @} */
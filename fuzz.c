@@ -0,0 +1,953 @@
+/**
+ * @file
+ * @brief Differential fuzz driver for the DLX solvers.
+ *
+ * Each input is decoded into a sudoku puzzle, a small 0/1 matrix for
+ * make_sparse, an exact cover problem file for dlx_read, the parameters of
+ * a dlx_gen_random problem, a stream of packed puzzles and solutions, or a
+ * puzzle and a symmetric copy for the canonical form and solution cache.
+ * Every solver that applies is run on it, and the driver aborts if they
+ * disagree, if a solution is not a valid exact cover, or if the matrix is
+ * not restored bit for bit afterwards (dlx_verify).  Sparse matrices are
+ * small enough to count their covers by brute force as the reference
+ * answer.
+ *
+ * Build and run with one of:
+ *
+ *     make fuzz && ./fuzz -r 100000           random inputs, no fuzzer needed
+ *     make fuzz CC=afl-clang-fast             afl-fuzz -i dir -o dir ./fuzz
+ *     make fuzz CC=clang FUZZFLAGS='-fsanitize=fuzzer,address -D LIBFUZZER'
+ *
+ * Run "make clean" before switching between them, so that every object is
+ * rebuilt with the same flags.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "dlx.h"
+#include "matrix.h"
+#include "dlx_file.h"
+#include "dlx_gen.h"
+#include "sudoku.h"
+#include "sudoku_bits.h"
+#include "sudoku_batch.h"
+#include "sudoku_grid.h"
+#include "sudoku_pack.h"
+#include "sudoku_canon.h"
+
+#define CAP         64      /* most solutions counted per input */
+#define MAX_ROWS    12
+#define MAX_COLS    10
+#define MAX_INPUT   4096
+
+#define CHECK(cond) ((cond) ? (void) 0 : fail(#cond, __LINE__))
+
+/** a valid grid that decoded puzzles take their givens from */
+static const char *base_grid =
+    "123456789456789123789123456214365897365897214897214365"
+    "531642978642978531978531642";
+
+static void fail(const char *what, int line)
+{
+    fprintf(stderr, "fuzz.c:%d: check failed: %s\n", line, what);
+    abort();
+}
+
+/**
+ * @name GROUP_FUZZ_SUDOKU
+ * Sudoku inputs: byte 0 is a blank threshold, the next 81 bytes the cells.
+ * A cell byte below the threshold is a blank, a byte of 0xf0 or above a
+ * random (possibly conflicting) digit, and anything else the digit from
+ * base_grid, so most puzzles are solvable and low thresholds give many
+ * solutions.
+ * @{
+ */
+
+static sudoku_dlx   *ctx;       /* reused across inputs, like a server */
+static sudoku_dlx   *pristine;  /* ctx right after sudoku_dlx_init */
+
+/** @brief the part of a sudoku_dlx that must be restored after a search */
+static int ctx_restored(void)
+{
+    return memcmp(ctx, pristine, offsetof(sudoku_dlx, givens)) == 0;
+}
+
+/** @return 1 if s is a complete valid grid that agrees with puzzle's givens */
+static int valid_solution(const char *s, const char *puzzle)
+{
+    int seen[27][10];
+    int i, r, c, d;
+
+    memset(seen, 0, sizeof(seen));
+    for (i = 0; i < 81; i++) {
+        if (s[i] < '1' || s[i] > '9')
+            return 0;
+        if (puzzle[i] >= '1' && puzzle[i] <= '9' && puzzle[i] != s[i])
+            return 0;
+        d = s[i] - '0';
+        r = i / 9;
+        c = i % 9;
+        if (seen[r][d]++ || seen[9 + c][d]++
+                || seen[18 + r / 3 * 3 + c / 3][d]++)
+            return 0;
+    }
+    return s[81] == '\0';
+}
+
+/**
+ * @brief Decode a puzzle from up to 82 bytes of data, as described above,
+ * taking the givens from grid
+ * @param puzzle    must have room for 82 char
+ */
+static void decode_puzzle(const char *grid, const unsigned char *data,
+                          size_t size, char *puzzle)
+{
+    unsigned char t = size > 0 ? data[0] : 0;
+    int i;
+
+    for (i = 0; i < 81; i++) {
+        if ((size_t) i + 1 >= size || data[i + 1] < t)
+            puzzle[i] = '.';
+        else if (data[i + 1] >= 0xf0)
+            puzzle[i] = '1' + data[i + 1] % 9;
+        else
+            puzzle[i] = grid[i];
+    }
+    puzzle[81] = '\0';
+}
+
+/** @return a number below n from the linear congruential generator seed */
+static unsigned long fuzz_rand(unsigned long *seed, unsigned long n)
+{
+    *seed = (*seed * 1103515245ul + 12345) & 0xfffffffful;
+    return (*seed >> 16) % n;
+}
+
+/** @brief shuffle the 3 entries of p */
+static void shuffle3(unsigned char p[], unsigned long *seed)
+{
+    unsigned char x;
+    int i, j;
+
+    for (i = 2; i > 0; i--) {
+        j = fuzz_rand(seed, i + 1);
+        x = p[i];
+        p[i] = p[j];
+        p[j] = x;
+    }
+}
+
+/**
+ * @brief out = in with its digits relabelled, its bands, stacks and the lines
+ * in them permuted and maybe transposed, all chosen by seed: a symmetry that
+ * takes valid grids to valid grids
+ * @param out   must have room for 82 char; blanks are written as '.'
+ */
+static void shuffle_grid(const char *in, char *out, unsigned long seed)
+{
+    unsigned char digits[10], lines[2][9], band[3], line[3];
+    int i, j, k, r, c, v, transpose;
+
+    for (i = 0; i < 10; i++)
+        digits[i] = i;
+    for (i = 9; i > 1; i--) {
+        j = 1 + fuzz_rand(&seed, i);
+        v = digits[i];
+        digits[i] = digits[j];
+        digits[j] = v;
+    }
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < 3; i++)
+            band[i] = i;
+        shuffle3(band, &seed);
+        for (i = 0; i < 3; i++) {
+            for (j = 0; j < 3; j++)
+                line[j] = j;
+            shuffle3(line, &seed);
+            for (j = 0; j < 3; j++)
+                lines[k][3 * i + j] = 3 * band[i] + line[j];
+        }
+    }
+    transpose = fuzz_rand(&seed, 2);
+    for (i = 0; i < 81; i++) {
+        r = lines[0][i / 9];
+        c = lines[1][i % 9];
+        v = in[transpose ? 9 * c + r : 9 * r + c];
+        out[i] = v >= '1' && v <= '9' ? '0' + digits[v - '0'] : '.';
+    }
+    out[81] = '\0';
+}
+
+/**
+ * @brief Play the singles find_hint gives on the UI board, from the givens
+ * of a puzzle with n solutions, the first of which is s1.  On a solvable
+ * board it must never see a mistake, and on a unique one every single must
+ * be the solution's digit.  Undoing them all must restore the unit counts.
+ * The running totals of collisions and wrong entries must match a recount
+ * after every move, and a wrong digit must be caught as soon as it is in.
+ */
+static void fuzz_grid(const char *puzzle, const char *s1, size_t n)
+{
+    static SudokuGrid board, given;
+    SudokuHint  hint;
+    char        values[82];
+    int         i, r, wrong, conflicts;
+
+    init_board(&board);
+    for (i = 0; i < 81; i++)
+        if (puzzle[i] >= '1' && puzzle[i] <= '9')
+            set_value(&board, i / 9 + 1, i % 9 + 1, puzzle[i]);
+    toggle_fix_mode(&board);
+    set_solution(&board, n == 1 ? s1 : NULL);
+    CHECK(board.conflicts == 0 && board.wrong == 0);
+    given = board;
+
+    while ((r = find_hint(&board, &hint)) == 1) {
+        CHECK(hint.cell >= 0 && hint.cell < 81);
+        CHECK(n != 1 || hint.val == s1[hint.cell]);
+        CHECK(set_value(&board, hint.cell / 9 + 1, hint.cell % 9 + 1,
+                        hint.val) == 0);
+        CHECK(board.conflicts == 0 && board.wrong == 0);
+    }
+    CHECK(n == 0 || r == 0);
+    get_values(&board, values);
+    CHECK(n != 1 || strchr(values, ' ') != NULL || strcmp(values, s1) == 0);
+
+    /* fill the rest in with digits that clash, or are just wrong */
+    for (i = 0; i < 81; i++) {
+        if (values[i] != ' ')
+            continue;
+        set_value(&board, i / 9 + 1, i % 9 + 1, '1' + (i + puzzle[0]) % 9);
+        wrong = conflicts = 0;
+        for (r = 0; r < 81; r++) {
+            CHECK(is_cell_wrong(&board, r / 9 + 1, r % 9 + 1)
+                  == (n == 1 && board.cells[r].val >= '1'
+                      && board.cells[r].val <= '9'
+                      && board.cells[r].val != s1[r]));
+            wrong += is_cell_wrong(&board, r / 9 + 1, r % 9 + 1);
+            conflicts += is_cell_conflict(&board, r / 9 + 1, r % 9 + 1);
+        }
+        CHECK(board.wrong == wrong);
+        CHECK((board.conflicts == 0) == (conflicts == 0));
+        CHECK(board.conflicts <= conflicts);
+    }
+
+    clear_board(&board);
+    CHECK(board.conflicts == 0 && board.wrong == 0);
+    CHECK(memcmp(board.count, given.count, sizeof(given.count)) == 0);
+    CHECK(memcmp(board.used, given.used, sizeof(given.used)) == 0);
+}
+
+static void fuzz_sudoku(const unsigned char *data, size_t size)
+{
+    sudoku_iter si;
+    sudoku_hint hints[81];
+    dlx_ctl     ctl;
+    const char *s, *batch_in[1];
+    char    puzzle[82], s1[82], s2[82], batch_out[1][82];
+    int     r1, r2, g, i, cell, r, c, d;
+    size_t  n, count;
+    unsigned char t = size > 0 ? data[0] : 0;
+
+    decode_puzzle(base_grid, data, size, puzzle);
+
+    /* one-shot solver against the reused context */
+    r1 = sudoku_solve(puzzle, s1);
+    if ((g = sudoku_load_givens(ctx, puzzle)) < 0) {
+        CHECK(r1 == 0);
+        CHECK(ctx_restored());
+        return;
+    }
+    CHECK(dlx_verify_links(&ctx->root) == 0);
+    r2 = sudoku_dlx_solve(ctx, s2);
+    CHECK(r1 == r2);
+    CHECK(!r1 || (valid_solution(s1, puzzle) && strcmp(s1, s2) == 0));
+    CHECK(dlx_verify_links(&ctx->root) == 0);
+
+    /* the hint trace must spell out the same solution */
+    CHECK(sudoku_dlx_solve_hints(ctx, hints) == r1);
+    if (r1) {
+        for (i = 0; i < 81; i++) {
+            hint2rcn(hints + i, &r, &c, &d);
+            s2[(r - 1) * 9 + c - 1] = '0' + d;
+        }
+        CHECK(strcmp(s1, s2) == 0);
+    }
+    CHECK(dlx_verify_links(&ctx->root) == 0);
+
+    /* counting solver against the enumerator */
+    n = sudoku_dlx_nsolve(ctx, NULL, CAP);
+    CHECK((n > 0) == (r1 > 0));
+    count = 0;
+    sudoku_iter_init(&si, ctx);
+    while (count < CAP && (s = sudoku_iter_next(&si)) != NULL) {
+        CHECK(valid_solution(s, puzzle));
+        count++;
+    }
+    sudoku_iter_abort(&si);
+    CHECK(count == n);
+    CHECK(dlx_verify_links(&ctx->root) == 0);
+    fuzz_grid(puzzle, s1, n);
+
+    /* the bitboard engine must count the same, and agree when unique */
+    CHECK(sudoku_bits_nsolve(puzzle, s2, CAP) == n);
+    CHECK(n == 0 || valid_solution(s2, puzzle));
+    CHECK(n != 1 || strcmp(s1, s2) == 0);
+
+    /* a budget too small for the search leaves the context untouched */
+    dlx_ctl_init(&ctl);
+    ctl.budget = t % 16;
+    count = sudoku_dlx_nsolve_ctl(ctx, s2, CAP, &ctl);
+    CHECK(count == DLX_EXHAUSTED || count == n);
+    CHECK(count != 1 || strcmp(s1, s2) == 0);
+    CHECK(dlx_verify_links(&ctx->root) == 0);
+
+    /* take out a given from the middle of the stack and put it back */
+    if (g > 0) {
+        cell = size > 82 ? data[82] % 81 : 0;
+        if (puzzle[cell] >= '1' && puzzle[cell] <= '9') {
+            CHECK(sudoku_clear_given(ctx, cell) == 0);
+            CHECK(sudoku_set_given(ctx, cell, puzzle[cell] - '0') == 0);
+            CHECK(sudoku_dlx_nsolve(ctx, NULL, CAP) == n);
+        }
+    }
+
+    /* so must the batched engine, which falls back on the same context */
+    batch_in[0] = puzzle;
+    sudoku_batch_nsolve(ctx, batch_in, batch_out, &count, 1, CAP);
+    CHECK(count == n);
+    CHECK(n == 0 || valid_solution(batch_out[0], puzzle));
+    CHECK(n != 1 || strcmp(s1, batch_out[0]) == 0);
+
+    sudoku_clear_givens(ctx);
+    CHECK(ctx_restored());
+}
+
+/** @} */
+
+/**
+ * @name GROUP_FUZZ_SPARSE
+ * Matrix inputs: bytes 0 and 1 give the number of rows and columns, byte 2 a
+ * density threshold, and each following byte one matrix entry, which is 1 if
+ * the byte is below the threshold.
+ * @{
+ */
+
+static dlx_snap snap[1 + MAX_COLS + MAX_ROWS * MAX_COLS];
+static size_t   nsnap;
+
+/** @return 1 if the k rows in sol cover each of the columns exactly once */
+static int valid_cover(node *sol[], size_t k, size_t columns)
+{
+    int covered[MAX_COLS];
+    size_t i, col;
+    node *j;
+
+    memset(covered, 0, sizeof(covered));
+    for (i = 0; i < k; i++) {
+        j = sol[i];
+        do {
+            col = *(const size_t *) j->chead->id;
+            if (covered[col]++)
+                return 0;
+        } while ((j = j->right) != sol[i]);
+    }
+    for (col = 0; col < columns; col++)
+        if (!covered[col])
+            return 0;
+    return 1;
+}
+
+/**
+ * @return number of exact covers of the matrix, by brute force: subsets of
+ *          its non-empty rows that cover every column exactly once
+ */
+static unsigned long count_covers(const int matrix[], size_t rows,
+                                  size_t columns)
+{
+    unsigned    masks[MAX_ROWS];
+    unsigned    used, full;
+    unsigned long subset, n;
+    size_t      i, j, nmasks;
+
+    nmasks = 0;
+    for (i = 0; i < rows; i++) {
+        masks[nmasks] = 0;
+        for (j = 0; j < columns; j++)
+            masks[nmasks] |= (unsigned) matrix[i * columns + j] << j;
+        if (masks[nmasks] != 0)
+            nmasks++;
+    }
+    full = (1u << columns) - 1;
+    n = 0;
+    for (subset = 0; subset < 1ul << nmasks; subset++) {
+        used = 0;
+        for (i = 0; i < nmasks; i++) {
+            if (!(subset & 1ul << i))
+                continue;
+            if (used & masks[i])
+                break;
+            used |= masks[i];
+        }
+        if (i == nmasks && used == full)
+            n++;
+    }
+    return n;
+}
+
+/** @brief first rows of the middle column that stand for their orbit */
+typedef struct {
+    const node  *rows[MAX_ROWS];
+    size_t      n;
+} mirror_orbits;
+
+/** @brief dlx_sym hook for mirrored matrices: orbits are pairs of rows */
+static unsigned long mirror_orbit(const node *row, void *arg)
+{
+    const mirror_orbits *m = arg;
+    size_t i;
+
+    for (i = 0; i < m->n; i++)
+        if (m->rows[i] == row)
+            return 2;
+    return 0;
+}
+
+/**
+ * @brief Make a matrix symmetric by appending to its first half rows, in
+ * order, their mirror images (columns reversed), and check that
+ * dlx_count_sym, searching under half the rows of the middle column, counts
+ * its covers right.
+ */
+static void fuzz_symmetry(int matrix[], size_t rows, size_t columns)
+{
+    mirror_orbits   m;
+    dlx_sym         sym;
+    dlx_ctl         ctl;
+    hnode           *h;
+    node            *i;
+    size_t          half = rows / 2, r, j, n;
+
+    if (columns % 2 == 0 || half == 0)
+        return;     /* no middle column, or nothing to mirror */
+    for (r = 0; r < half; r++)
+        for (j = 0; j < columns; j++)
+            matrix[(half + r) * columns + j] =
+                matrix[r * columns + columns - 1 - j];
+    if ((h = make_sparse(matrix, 2 * half, columns)) == NULL)
+        return;
+
+    /* the middle column's rows from the first half come before the
+     * mirrored ones, since make_sparse adds rows in order */
+    sym.column = h + 1 + columns / 2;
+    sym.orbit  = mirror_orbit;
+    sym.arg    = &m;
+    m.n = 0;
+    for (r = 0; r < half; r++)
+        m.n += matrix[r * columns + columns / 2];
+    for (i = (node *) sym.column, j = 0; j < m.n; j++)
+        m.rows[j] = i = i->down;
+
+    dlx_ctl_init(&ctl);
+    n = dlx_count_sym(h, &sym, &ctl);
+    CHECK(n == count_covers(matrix, 2 * half, columns));
+    CHECK(dlx_verify_links(h) == 0);
+    free_sparse(h, columns);
+}
+
+static void fuzz_sparse(const unsigned char *data, size_t size)
+{
+    int         matrix[MAX_ROWS * MAX_COLS];
+    node        *sol[MAX_COLS];
+    dlx_hint    hints[MAX_COLS];
+    dlx_iter    it;
+    dlx_ctl     ctl;
+    dlx_est     est;
+    hnode       *h, *roots[2];
+    node        *arena;
+    size_t      rows, columns, i, j, k;
+    unsigned long brute, n;
+    unsigned char t;
+
+    if (size < 3)
+        return;
+    rows    = 1 + data[0] % MAX_ROWS;
+    columns = 1 + data[1] % MAX_COLS;
+    t       = data[2];
+    data += 3;
+    size -= 3;
+
+    for (i = 0; i < rows * columns; i++)
+        matrix[i] = i < size && data[i] < t;
+    brute = count_covers(matrix, rows, columns);
+
+    if ((h = make_sparse(matrix, rows, columns)) == NULL)
+        return;
+    nsnap = dlx_snapshot(h, snap, sizeof(snap) / sizeof(*snap));
+    CHECK(nsnap <= sizeof(snap) / sizeof(*snap));
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    n = (1ul << MAX_ROWS) - dlx_has_covers(h, 1ul << MAX_ROWS);
+    CHECK(n == brute);
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    k = dlx_exact_cover(sol, h, 0);
+    CHECK((k > 0) == (brute > 0));
+    CHECK(k == 0 || valid_cover(sol, k, columns));
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    CHECK(dlx_exact_cover_hints(hints, h, 0) == k);
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    n = 0;
+    dlx_iter_init(&it, h, sol, columns);
+    while (dlx_iter_next(&it)) {
+        CHECK(valid_cover(sol, it.k, columns));
+        CHECK(dlx_verify_links(h) == 0);
+        n++;
+    }
+    CHECK(n == brute);
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    /* stopping early must restore the matrix too */
+    dlx_iter_init(&it, h, sol, columns);
+    dlx_iter_next(&it);
+    dlx_iter_abort(&it);
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    /* random tie-breaking and row order, with a restart every few nodes */
+    dlx_ctl_init(&ctl);
+    ctl.seed = 1 + t;
+    ctl.restart = 1 + t % 4;
+    k = dlx_exact_cover_ctl(sol, h, &ctl);
+    CHECK((k > 0) == (brute > 0));
+    CHECK(k == 0 || valid_cover(sol, k, columns));
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    /* a small budget: either the right answer, or exhausted */
+    dlx_ctl_init(&ctl);
+    ctl.budget = 1 + t % 8;
+    k = dlx_has_covers_ctl(h, 1ul << MAX_ROWS, &ctl);
+    CHECK(k == DLX_EXHAUSTED || (1ul << MAX_ROWS) - k == brute);
+    CHECK(ctl.nodes <= ctl.budget);
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+    ctl.nodes = 0;
+    ctl.seed = t;
+    k = dlx_exact_cover_ctl(sol, h, &ctl);
+    CHECK(k == DLX_EXHAUSTED || (k > 0) == (brute > 0));
+    CHECK(k == DLX_EXHAUSTED || k == 0 || valid_cover(sol, k, columns));
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    /* every probe that reaches a leaf with no columns left has found a
+     * cover, so there are no solutions to estimate if there are no covers */
+    dlx_ctl_init(&ctl);
+    ctl.seed = t;
+    dlx_estimate(h, 1 + t % 16, &ctl, &est);
+    CHECK(est.probes == 1ul + t % 16);
+    CHECK(brute > 0 || est.solutions == 0);
+    CHECK(est.solutions >= 0 && est.nodes >= 0);
+    CHECK(dlx_verify(h, snap, nsnap) == 0);
+
+    /* a portfolio of two on two copies of the matrix, the second one laid
+     * out again by compact_sparse */
+    dlx_ctl_init(&ctl);
+    ctl.seed = t;
+    ctl.restart = 1 + t % 4;
+    roots[0] = h;
+    if ((roots[1] = make_sparse(matrix, rows, columns)) != NULL) {
+        CHECK((arena = compact_sparse(roots[1], columns)) != NULL);
+        CHECK(dlx_verify_links(roots[1]) == 0);
+        k = dlx_portfolio(sol, columns, roots, 2, &ctl, &j);
+        CHECK(j < 2);
+        CHECK((k > 0) == (brute > 0));
+        CHECK(k == 0 || valid_cover(sol, k, columns));
+        CHECK(dlx_verify(h, snap, nsnap) == 0);
+        CHECK(dlx_verify_links(roots[1]) == 0);
+
+        /* and a count split between two threads */
+        dlx_ctl_init(&ctl);
+        CHECK(dlx_count_parallel(roots, 2, &ctl) == brute);
+        CHECK(dlx_verify(h, snap, nsnap) == 0);
+        CHECK(dlx_verify_links(roots[1]) == 0);
+        free_compact(roots[1], arena);
+    }
+
+    free_sparse(h, columns);
+    fuzz_symmetry(matrix, rows, columns);
+}
+
+/** @} */
+
+static sudoku_cache cache;  /* small, so that entries get recycled */
+
+static void init(void)
+{
+    if (ctx != NULL)
+        return;
+    ctx = malloc(sizeof(*ctx));
+    pristine = malloc(sizeof(*pristine));
+    if (ctx == NULL || pristine == NULL || sudoku_cache_init(&cache, 8) != 0) {
+        perror("fuzz");
+        exit(EXIT_FAILURE);
+    }
+    sudoku_dlx_init(ctx);
+    memcpy(pristine, ctx, sizeof(*ctx));
+    CHECK(valid_solution(base_grid, base_grid));
+}
+
+/**
+ * @name GROUP_FUZZ_FILE
+ * Problem file inputs: if byte 0 is odd, the rest follows a binary header.
+ * If even, byte 0 picks an item line and each byte after it a token (an
+ * item, a line break or a comment) of a text file, with the odd bad name;
+ * an item already on the line is skipped, so that most options are valid.
+ * Files that dlx_read takes must survive being written in either format
+ * and read back, and being laid out again by dlx_problem_compact, with the
+ * same number of covers.
+ * @{
+ */
+
+/** @brief Write p with write, read it back into q, and compare them */
+static void round_trip(dlx_problem *p, size_t n,
+                       int (*write)(const dlx_problem *, FILE *))
+{
+    dlx_problem q;
+    FILE *f;
+
+    if ((f = tmpfile()) == NULL)
+        return;
+    CHECK(write(p, f) == 0);
+    rewind(f);
+    CHECK(dlx_read(&q, f) == 0);
+    fclose(f);
+    CHECK(q.nitems == p->nitems && q.nprimary == p->nprimary);
+    CHECK(q.noptions == p->noptions && q.nnodes == p->nnodes);
+    CHECK(dlx_verify_links(&q.root) == 0);
+    CHECK(CAP - dlx_has_covers(&q.root, CAP) == n);
+    dlx_problem_free(&q);
+}
+
+static void fuzz_file(const unsigned char *data, size_t size)
+{
+    static const char *items[] = {
+        "a b c d x y", "a b c d | x y", "| c\na b | c d x y", "a b a",
+        "a b: c"
+    };
+    static const char *tokens[] = {
+        " a", " b", " c", " d", " x", " y", "\n", "\n", "\n", "\n",
+        "\n| c\n", " e:"
+    };
+    dlx_problem p;
+    FILE    *f;
+    size_t  i, n;
+    unsigned used = 0;
+    int     r, k;
+
+    if (size == 0 || (f = tmpfile()) == NULL)
+        return;
+    if (data[0] & 1) {
+        fwrite("\0DLX\1", 1, 5, f);
+        fwrite(data + 1, 1, size - 1, f);
+    } else {
+        fputs(items[data[0] / 2 % 5], f);
+        putc('\n', f);
+        for (i = 1; i < size; i++) {
+            k = data[i] % 12 < 11 || data[i] > 0xf0 ? data[i] % 12 : 6;
+            if (k < 6 && (used & 1u << k))
+                continue;
+            used = k < 6 ? used | 1u << k : 0;
+            fputs(tokens[k], f);
+        }
+    }
+    rewind(f);
+    r = dlx_read(&p, f);
+    fclose(f);
+    if (r < 0) {
+        CHECK(p.error != NULL);
+        return;
+    }
+
+    CHECK(dlx_verify_links(&p.root) == 0);
+    n = CAP - dlx_has_covers(&p.root, CAP);
+    CHECK(dlx_verify_links(&p.root) == 0);
+    if (p.nprimary > 0)
+        round_trip(&p, n, dlx_write_text);
+    round_trip(&p, n, dlx_write_binary);
+
+    /* laid out again, it must be the same problem */
+    CHECK(dlx_problem_compact(&p) == 0);
+    CHECK(dlx_verify_links(&p.root) == 0);
+    CHECK(CAP - dlx_has_covers(&p.root, CAP) == n);
+    round_trip(&p, n, dlx_write_binary);
+    dlx_problem_free(&p);
+}
+
+/**
+ * @brief A small problem from dlx_gen_random with parameters from the input:
+ * the hidden solution means it has at least one cover, and it must write
+ * and read back like any other.
+ */
+static void fuzz_gen(const unsigned char *data, size_t size)
+{
+    dlx_problem p;
+    size_t  n;
+
+    if (size < 4)
+        return;
+    if (dlx_gen_random(&p, 1 + data[0] % 16, data[1] % 32,
+                       (1 + data[2] % 8) / 8.0, data[3]) < 0) {
+        CHECK(p.error != NULL);
+        return;
+    }
+    CHECK(p.nitems == 1u + data[0] % 16 && p.nprimary == p.nitems);
+    CHECK(dlx_verify_links(&p.root) == 0);
+    n = CAP - dlx_has_covers(&p.root, CAP);
+    CHECK(n >= 1);
+    round_trip(&p, n, dlx_write_text);
+    round_trip(&p, n, dlx_write_binary);
+    dlx_problem_free(&p);
+}
+
+/** @} */
+
+/**
+ * @name GROUP_FUZZ_PACK
+ * Packed stream inputs: byte 0 picks the record kinds and the number of
+ * entries, byte 1 which entries have a solution and where the stream is
+ * cut or damaged, byte 2 the byte of a packed solution to flip, and the
+ * rest a sudoku puzzle as above, given from a shuffled base_grid for each
+ * entry.  The stream must read back as written, and cut short or with a
+ * bad header, it must fail where it should.
+ * @{
+ */
+
+/** @return a temporary file holding the n bytes of buf, rewound */
+static FILE *stream_of(const unsigned char *buf, size_t n)
+{
+    FILE *f;
+
+    if ((f = tmpfile()) == NULL)
+        return NULL;
+    CHECK(fwrite(buf, 1, n, f) == n);
+    rewind(f);
+    return f;
+}
+
+static void fuzz_pack(const unsigned char *data, size_t size)
+{
+    static const int kinds[] = {
+        PACK_PUZZLE, PACK_SOLUTION, PACK_PUZZLE | PACK_SOLUTION
+    };
+    unsigned char buf[PACKED_HEADER_SIZE
+                      + 4 * (PACKED_PUZZLE_SIZE + PACKED_SOLUTION_SIZE)];
+    unsigned char packed[PACKED_SOLUTION_SIZE], again[PACKED_SOLUTION_SIZE];
+    char    puzzles[4][82], solutions[4][82], puzzle[82], solution[82];
+    size_t  len, rec, cut;
+    int     kind, n, i, k;
+    FILE    *f;
+
+    if (size < 3 || (f = tmpfile()) == NULL)
+        return;
+    kind = kinds[data[0] % 3];
+    n = 1 + data[0] / 3 % 4;
+    rec = (kind & PACK_PUZZLE ? PACKED_PUZZLE_SIZE : 0)
+        + (kind & PACK_SOLUTION ? PACKED_SOLUTION_SIZE : 0);
+
+    CHECK(pack_write_header(f, kind) == 0);
+    for (i = 0; i < n; i++) {
+        shuffle_grid(base_grid, solutions[i], (unsigned long) data[0] << 8
+                     | data[2] << 2 | i);
+        decode_puzzle(solutions[i], data + 3, size - 3, puzzles[i]);
+        CHECK(pack_write(f, kind, puzzles[i],
+                         data[1] >> i & 1 ? NULL : solutions[i]) == 0);
+    }
+    len = ftell(f);
+    CHECK(len == PACKED_HEADER_SIZE + n * rec);
+    rewind(f);
+    CHECK(fread(buf, 1, len, f) == len);
+    rewind(f);
+
+    /* read back as written */
+    CHECK(pack_read_header(f) == kind);
+    for (i = 0; i < n; i++) {
+        CHECK(pack_read(f, kind, puzzle, solution) == 1);
+        CHECK(!(kind & PACK_PUZZLE) || strcmp(puzzle, puzzles[i]) == 0);
+        if (kind & PACK_SOLUTION)
+            CHECK(data[1] >> i & 1 ? solution[0] == '\0'
+                  : strcmp(solution, solutions[i]) == 0);
+    }
+    CHECK(pack_read(f, kind, puzzle, solution) == 0);
+    fclose(f);
+
+    /* cut short: whole records read, then a partial one is an error */
+    cut = PACKED_HEADER_SIZE + data[1] % (n * rec);
+    if ((f = stream_of(buf, cut)) != NULL) {
+        CHECK(pack_read_header(f) == kind);
+        for (i = 0; (size_t) i < (cut - PACKED_HEADER_SIZE) / rec; i++)
+            CHECK(pack_read(f, kind, puzzle, solution) == 1);
+        CHECK(pack_read(f, kind, puzzle, solution)
+              == ((cut - PACKED_HEADER_SIZE) % rec ? -1 : 0));
+        fclose(f);
+    }
+
+    /* a header too short, or with a bad magic, version or kind */
+    if ((f = stream_of(buf, data[1] % PACKED_HEADER_SIZE)) != NULL) {
+        CHECK(pack_read_header(f) == -1);
+        fclose(f);
+    }
+    k = data[1] % 6;
+    buf[k] ^= k == 5 ? kind : 0x80;
+    if ((f = stream_of(buf, len)) != NULL) {
+        CHECK(pack_read_header(f) == -1);
+        fclose(f);
+    }
+
+    /* a damaged solution either is rejected or packs back the same */
+    CHECK(pack_solution(packed, solutions[0]) == 0);
+    packed[data[2] % PACKED_SOLUTION_SIZE] ^= 1 + data[1];
+    if (unpack_solution(solution, packed) == 0) {
+        CHECK(pack_solution(again, solution) == 0);
+        CHECK(memcmp(packed, again, sizeof(packed)) == 0);
+    }
+}
+
+/** @} */
+
+/**
+ * @name GROUP_FUZZ_CANON
+ * Canonical form inputs: bytes 0 and 1 seed a symmetry, and the rest are a
+ * sudoku puzzle as above, but with an eighth to five eighths of its cells
+ * blank, and the input repeated if it is too short for every cell: base_grid
+ * has many symmetries, and full or nearly empty grids make the search run to
+ * its budget every time.  The puzzle and its image under the symmetry must
+ * have the same canonical form, unless the search for either ran out of
+ * budget, and the solution cache must answer both as sudoku_nsolve does.
+ * @{
+ */
+
+/** @brief Check the cache against sudoku_nsolve on puzzle */
+static void check_cached(const char *puzzle)
+{
+    char    s1[82], s2[82];
+    size_t  n;
+
+    n = sudoku_nsolve(puzzle, s1, 2);
+    CHECK(sudoku_cache_nsolve(&cache, puzzle, s2) == (int) n);
+    CHECK(n == 0 || valid_solution(s2, puzzle));
+    CHECK(n != 1 || strcmp(s1, s2) == 0);
+}
+
+static void fuzz_canon(const unsigned char *data, size_t size)
+{
+    sudoku_transform t;
+    unsigned char cells[82];
+    char    puzzle[82], image[82], canon1[82], canon2[82], back[82];
+    unsigned long hits;
+    size_t  i;
+    int     exact;
+
+    if (size < 3)
+        return;
+    for (i = 0; i < sizeof(cells); i++)
+        cells[i] = data[2 + i % (size - 2)];
+    cells[0] = 32 + cells[0] % 128;
+    decode_puzzle(base_grid, cells, sizeof(cells), puzzle);
+    shuffle_grid(puzzle, image, (unsigned long) data[0] << 8 | data[1]);
+
+    /* the transform takes the puzzle to its canonical form and back */
+    exact = sudoku_canonicalize(puzzle, canon1, &t);
+    sudoku_transform_apply(&t, puzzle, back);
+    CHECK(strcmp(back, canon1) == 0);
+    sudoku_transform_invert(&t, canon1, back);
+    CHECK(strcmp(back, puzzle) == 0);
+
+    exact &= sudoku_canonicalize(image, canon2, &t);
+    CHECK(!exact || strcmp(canon1, canon2) == 0);
+
+    /* so the copy is a hit */
+    check_cached(puzzle);
+    hits = cache.hits;
+    check_cached(image);
+    CHECK(!exact || cache.hits == hits + 1);
+}
+
+/** @} */
+
+/** @brief libFuzzer entry point: byte 0 chooses the kind of input */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    init();
+    if (size == 0)
+        return 0;
+    switch (data[0] % 6) {
+        case 0:
+            fuzz_sudoku(data + 1, size - 1);
+            break;
+        case 1:
+            fuzz_sparse(data + 1, size - 1);
+            break;
+        case 2:
+            fuzz_file(data + 1, size - 1);
+            break;
+        case 3:
+            fuzz_gen(data + 1, size - 1);
+            break;
+        case 4:
+            fuzz_pack(data + 1, size - 1);
+            break;
+        default:
+            fuzz_canon(data + 1, size - 1);
+    }
+    return 0;
+}
+
+#ifndef LIBFUZZER
+
+/** @brief Run one input read from f, as afl-fuzz does through stdin */
+static void run_file(FILE *f)
+{
+    static unsigned char buf[MAX_INPUT];
+
+    LLVMFuzzerTestOneInput(buf, fread(buf, 1, sizeof(buf), f));
+}
+
+int main(int argc, char *argv[])
+{
+    static unsigned char buf[MAX_INPUT];
+    unsigned long count, i;
+    size_t size, j;
+    FILE *f;
+    int k;
+
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0) {
+        /* random inputs: -r count [seed] */
+        count = strtoul(argv[2], NULL, 10);
+        srand(argc > 3 ? atoi(argv[3]) : 1);
+        for (i = 0; i < count; i++) {
+            size = rand() % 160;
+            for (j = 0; j < size; j++)
+                buf[j] = rand();
+            LLVMFuzzerTestOneInput(buf, size);
+        }
+        printf("%lu inputs ok\n", count);
+        return 0;
+    }
+
+    if (argc < 2) {
+        run_file(stdin);
+        return 0;
+    }
+    for (k = 1; k < argc; k++) {
+        if ((f = fopen(argv[k], "rb")) == NULL) {
+            perror(argv[k]);
+            return EXIT_FAILURE;
+        }
+        run_file(f);
+        fclose(f);
+    }
+    return 0;
+}
+
+#endif
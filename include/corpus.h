@@ -0,0 +1,27 @@
+/** @file */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+
+/** size of the read buffer used when the input cannot be memory mapped */
+#define CORPUS_BUFSIZE (1 << 20)
+
+/** @brief A file of puzzles, one 81 character puzzle per line. */
+typedef struct {
+    const char *data;   /**< corpus text, mapped or buffered */
+    size_t  len;        /**< number of valid bytes in data */
+    size_t  pos;        /**< offset of the next unparsed line in data */
+    int     fd;         /**< input file descriptor */
+    int     mapped;     /**< nonzero if data is an mmap of the whole file */
+    int     eof;        /**< nonzero once a buffered read hit end of file */
+    char    *buf;       /**< read buffer when not mapped */
+} corpus;
+
+int         corpus_open(corpus *cp, const char *path);
+const char  *corpus_next(corpus *cp);
+size_t      corpus_next_slice(corpus *cp, const char *puzzles[], size_t n);
+void        corpus_close(corpus *cp);
+
+#endif
@@ -12,6 +12,18 @@
 
 #include <stddef.h>
 
+/**
+ * @name GROUP_DLX_VERSION
+ * Version of the libdlx API.  The major version changes whenever a change
+ * breaks existing callers (including the layout of any struct in the
+ * headers); it is also the shared library's soname version.
+ * @{
+ */
+#define DLX_VERSION_MAJOR   0
+#define DLX_VERSION_MINOR   5
+#define DLX_VERSION         "0.5"
+/** @} */
+
 struct headnode_s;
 
 struct node_s {
@@ -38,12 +50,118 @@ typedef struct {
     size_t s;           /**< number of other rows in the column at the time */
 } dlx_hint;
 
+/** @brief State of a dlx_iter_next enumeration. */
+typedef enum {
+    DLX_ITER_START,     /**< nothing covered yet */
+    DLX_ITER_FOUND,     /**< rows[0 .. k - 1] is a solution */
+    DLX_ITER_DONE       /**< all solutions seen; matrix fully restored */
+} dlx_iter_state;
+
+/**
+ * @brief Non-recursive enumerator over all exact covers of a matrix.  Its
+ * only storage is the caller's rows[] array, so memory use does not grow
+ * with the number of solutions.
+ */
+typedef struct {
+    hnode   *root;
+    node    **rows;     /**< current partial solution, one row per level */
+    size_t  max;        /**< capacity of rows */
+    size_t  k;          /**< number of rows in the current partial solution */
+    dlx_iter_state state;
+} dlx_iter;
+
+/** @brief One node (or column header) as recorded by dlx_snapshot. */
+typedef struct {
+    node    *at;        /**< the node the entry was taken from */
+    node    links;      /**< copy of its links */
+    size_t  s;          /**< column size for headers and the root, else 0 */
+} dlx_snap;
+
+/** returned by the searches that take a dlx_ctl when they give up */
+#define DLX_EXHAUSTED ((size_t) -1)
+
+/**
+ * @brief Controls for the searches that take a dlx_ctl; dlx_ctl_init sets
+ * one up for the plain deterministic search with no limits.  A search that
+ * runs out of budget or is stopped returns DLX_EXHAUSTED.
+ */
+typedef struct {
+    unsigned long   seed;       /**< 0 for the usual order, else a seed for
+                                     random tie-breaking and row order */
+    unsigned long   restart;    /**< with a seed, restart the search after
+                                     restart times luby(i) nodes in run i;
+                                     0 never restarts */
+    unsigned long   budget;     /**< give up once nodes reaches this; 0
+                                     for no limit */
+    volatile int    *stop;      /**< if not NULL, give up as soon as *stop
+                                     is nonzero */
+    unsigned long   nodes;      /**< out: search nodes visited */
+    unsigned long   restarts;   /**< out: runs abandoned and restarted */
+} dlx_ctl;
+
+/** @brief Estimates made by dlx_estimate. */
+typedef struct {
+    unsigned long probes;       /**< random paths averaged over */
+    double  solutions;          /**< estimated number of exact covers */
+    double  solutions_ci;       /**< half width of its 95% confidence
+                                     interval */
+    double  nodes;              /**< estimated search nodes for a full
+                                     count */
+    double  nodes_ci;           /**< half width of its 95% confidence
+                                     interval */
+} dlx_est;
+
+/**
+ * @brief Symmetries of a matrix, as dlx_count_sym takes them: a column that
+ * every symmetry maps to itself, and which of its rows stand for their orbit.
+ */
+typedef struct {
+    hnode   *column;    /**< column fixed by every symmetry */
+    unsigned long (*orbit)(const node *row, void *arg);
+                        /**< for a row of column: the size of the row's
+                             orbit if the row stands for it, else 0 */
+    void    *arg;       /**< passed to orbit */
+} dlx_sym;
+
+/** @brief Layout of a matrix in memory, as dlx_layout_stats measures it. */
+typedef struct {
+    size_t  nodes;      /**< nodes reachable from the root, headers aside */
+    size_t  reads;      /**< node reads made covering each column once */
+    size_t  misses;     /**< of those, misses in a 32 KiB model cache */
+} dlx_layout;
+
 size_t dlx_exact_cover(node *solution[], hnode *root, size_t k);
 size_t dlx_has_covers(hnode *root, size_t k);
 size_t dlx_exact_cover_hints(dlx_hint solution[], hnode *root, size_t k);
 
+void   dlx_ctl_init(dlx_ctl *ctl);
+size_t dlx_exact_cover_ctl(node *solution[], hnode *root, dlx_ctl *ctl);
+size_t dlx_has_covers_ctl(hnode *root, size_t k, dlx_ctl *ctl);
+void   dlx_estimate(hnode *root, unsigned long probes, dlx_ctl *ctl,
+                    dlx_est *est);
+size_t dlx_count_sym(hnode *root, const dlx_sym *sym, dlx_ctl *ctl);
+
+/* in dlx_portfolio.c; link with -lpthread */
+size_t dlx_portfolio(node *solution[], size_t max, hnode *roots[], size_t n,
+                     dlx_ctl *ctl, size_t *winner);
+size_t dlx_count_parallel(hnode *roots[], size_t n, dlx_ctl *ctl);
+
+void dlx_iter_init(dlx_iter *it, hnode *root, node *rows[], size_t max);
+int  dlx_iter_next(dlx_iter *it);
+void dlx_iter_abort(dlx_iter *it);
+
 int dlx_force_row(node *r);
 int dlx_unselect_row(node *r);
+int dlx_propagate(hnode *root, node *rows[], size_t *n, size_t max);
+
+int    dlx_verify_links(hnode *root);
+size_t dlx_snapshot(hnode *root, dlx_snap snap[], size_t max);
+int    dlx_verify(hnode *root, const dlx_snap snap[], size_t n);
+
+void   dlx_layout_stats(hnode *root, dlx_layout *l);
+size_t dlx_compact(hnode *root, node arena[]);
+
+const char *dlx_version(void);
 
 hnode *dlx_make_headers(hnode *root, hnode *headers, size_t n);
 void  dlx_make_row(node *nodes, hnode *headers, int cols[], size_t n);
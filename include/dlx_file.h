@@ -0,0 +1,62 @@
+/** @file */
+
+#ifndef DLX_FILE_H
+#define DLX_FILE_H
+
+#include <stdio.h>
+#include "dlx.h"
+
+/** longest item name, as in Knuth's dlx1 */
+#define DLX_NAME_MAX    8
+
+/** option nodes per arena block, unless a single option needs more */
+#define DLX_ARENA_NODES 4096
+
+/** @brief A block of the arena the option nodes of a dlx_problem live in. */
+typedef struct dlx_block_s {
+    struct dlx_block_s *next;
+    size_t  used;
+    size_t  size;
+    node    nodes[1];       /**< really size nodes */
+} dlx_block;
+
+/**
+ * @brief A general exact cover problem: named items (columns), primary ones
+ * first, and options (rows) over them.  Secondary items are not on the
+ * header list, so a solution need not cover them, but still at most once.
+ *
+ * Built by dlx_read, or by dlx_problem_init and dlx_problem_add_option;
+ * root is the matrix to hand to the searches.
+ */
+typedef struct {
+    hnode   root;
+    hnode   *items;         /**< nitems headers, primary items first */
+    char    (*names)[DLX_NAME_MAX + 1]; /**< names[i] is items[i].id */
+    size_t  nitems;
+    size_t  nprimary;
+    node    **options;      /**< first node of each option, in order */
+    size_t  noptions;
+    size_t  nnodes;         /**< nodes in all options */
+    size_t  capacity;       /**< room in options */
+    size_t  *last;          /**< option that last used each item, plus 1 */
+    dlx_block *arena;       /**< blocks the option nodes live in, newest
+                                 first */
+    size_t  block;          /**< nodes to give the next block */
+    int     *cols;          /**< scratch: item indices of one option */
+    size_t  line;           /**< line of a text file dlx_read stopped at */
+    const char *error;      /**< why dlx_read failed, or NULL */
+} dlx_problem;
+
+int     dlx_problem_init(dlx_problem *p, size_t nitems, size_t nprimary,
+                         size_t nnodes);
+int     dlx_problem_add_option(dlx_problem *p, const int items[], size_t n);
+int     dlx_problem_copy(dlx_problem *dst, const dlx_problem *src);
+int     dlx_problem_compact(dlx_problem *p);
+void    dlx_problem_free(dlx_problem *p);
+size_t  dlx_item_index(const dlx_problem *p, const hnode *item);
+
+int     dlx_read(dlx_problem *p, FILE *f);
+int     dlx_write_text(const dlx_problem *p, FILE *f);
+int     dlx_write_binary(const dlx_problem *p, FILE *f);
+
+#endif
@@ -0,0 +1,24 @@
+/** @file */
+
+#ifndef DLX_GEN_H
+#define DLX_GEN_H
+
+#include "dlx.h"
+#include "dlx_file.h"
+
+/** @brief A pentomino box, for the symmetry hook of dlx_gen_box_sym. */
+typedef struct {
+    const dlx_problem *p;
+    int     width;
+    int     height;
+} dlx_box;
+
+int dlx_gen_queens(dlx_problem *p, int n);
+int dlx_gen_pentominoes(dlx_problem *p, int width, int height);
+int dlx_gen_langford(dlx_problem *p, int n);
+int dlx_gen_random(dlx_problem *p, int nitems, int noptions, double density,
+                   unsigned long seed);
+void dlx_gen_box_sym(dlx_sym *sym, dlx_box *box, const dlx_problem *p,
+                     int width, int height);
+
+#endif
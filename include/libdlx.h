@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @brief Everything libdlx exports: the generic DLX solver, the sparse matrix
+ * builder, problem file reader and problem generators, the sudoku encoder
+ * with its packed format, canonical forms and cache, and the bitboard and
+ * batched sudoku solvers.
+ *
+ * The library keeps no global state, apart from the kernel the bitboard
+ * solver picks once, under pthread_once, on its first call.  All memory is
+ * owned by the caller: a solver context (a sudoku_dlx, a matrix from
+ * make_sparse, a sudoku_cache) can be set up once and reused for any number
+ * of calls, and different threads may use different contexts at the same
+ * time.  A single context must not be used by two threads at once.
+ */
+
+#ifndef LIBDLX_H
+#define LIBDLX_H
+
+#include "dlx.h"
+#include "matrix.h"
+#include "dlx_file.h"
+#include "dlx_gen.h"
+#include "sudoku.h"
+#include "sudoku_pack.h"
+#include "sudoku_canon.h"
+#include "sudoku_bits.h"
+#include "sudoku_batch.h"
+
+#endif
@@ -6,5 +6,8 @@
 #include "dlx.h"
 
 hnode * make_sparse(const int *matrix, size_t rows, size_t columns);
+node  * compact_sparse(hnode *h, size_t columns);
+void    free_sparse(hnode *h, size_t columns);
+void    free_compact(hnode *h, node *arena);
 
 #endif
@@ -0,0 +1,14 @@
+/** @file */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+/** size of a connection's request and response buffers */
+#define SERVER_BUFSIZE (1 << 16)
+
+/** number of idle solver contexts kept for reuse by later connections */
+#define SERVER_POOL 64
+
+int server_run(const char *path, int verbose, unsigned long budget);
+
+#endif
@@ -22,14 +22,27 @@ typedef struct {
     hnode headers[NCOLS];
     int   ids[NCOLS];
     node  nodes[NROWS][NTYPES];
+    node  *givens[81];  /**< forced given rows, in dlx_force_row order */
+    size_t ngivens;     /**< number of rows in givens */
 } sudoku_dlx;
 
+/** @brief The cells (0 - 80) of each row, column and region, in that order */
+extern const unsigned char sudoku_unit_cells[27][9];
+
 typedef struct {
     int    constraint_id;  /**< see sudoku.c */
     size_t solution_id;    /**< see sudoku.c */
     int    nchoices;       /**< number of other possible choices at the time */
 } sudoku_hint;
 
+/** @brief Enumerator over all solutions of a sudoku_dlx; see sudoku_iter_init */
+typedef struct {
+    sudoku_dlx  *puzzle_dlx;
+    dlx_iter    it;
+    node        *rows[81];
+    char        buf[82];    /**< current solution */
+} sudoku_iter;
+
 int     sudoku_solve(const char *puzzle, char *buf);
 size_t  sudoku_nsolve(const char *puzzle, char *buf, size_t n);
 int     sudoku_solve_hints(const char *puzzle, sudoku_hint hints[]);
@@ -37,4 +50,21 @@ size_t  hint2cells(sudoku_hint *hint, int cell_ids[]);
 void    hint2rcn(sudoku_hint *hint, int *r, int *c, int *n);
 sudoku_hint *next_hint(sudoku_hint hints[], char *board);
 
+void    sudoku_dlx_init(sudoku_dlx *puzzle_dlx);
+int     sudoku_set_given(sudoku_dlx *puzzle_dlx, int cell, int n);
+int     sudoku_clear_given(sudoku_dlx *puzzle_dlx, int cell);
+void    sudoku_clear_givens(sudoku_dlx *puzzle_dlx);
+int     sudoku_load_givens(sudoku_dlx *puzzle_dlx, const char *puzzle);
+int     sudoku_dlx_solve(sudoku_dlx *puzzle_dlx, char *buf);
+size_t  sudoku_dlx_nsolve(sudoku_dlx *puzzle_dlx, char *buf, size_t n);
+int     sudoku_dlx_solve_ctl(sudoku_dlx *puzzle_dlx, char *buf, dlx_ctl *ctl);
+size_t  sudoku_dlx_nsolve_ctl(sudoku_dlx *puzzle_dlx, char *buf, size_t n,
+                              dlx_ctl *ctl);
+void    sudoku_dlx_estimate(sudoku_dlx *puzzle_dlx, unsigned long probes,
+                            dlx_ctl *ctl, dlx_est *est);
+int     sudoku_dlx_solve_hints(sudoku_dlx *puzzle_dlx, sudoku_hint hints[]);
+void    sudoku_iter_init(sudoku_iter *si, sudoku_dlx *puzzle_dlx);
+const char *sudoku_iter_next(sudoku_iter *si);
+void    sudoku_iter_abort(sudoku_iter *si);
+
 #endif
@@ -0,0 +1,17 @@
+/** @file */
+
+#ifndef SUDOKU_BATCH_H
+#define SUDOKU_BATCH_H
+
+#include <stddef.h>
+#include "sudoku.h"
+
+/** puzzles propagated together, one per 16-bit lane of a 256-bit vector */
+#define SUDOKU_BATCH_LANES 16
+
+size_t      sudoku_batch_nsolve(sudoku_dlx *fallback, const char *puzzles[],
+                                char solutions[][82], size_t counts[],
+                                size_t n, size_t max);
+const char  *sudoku_batch_kernel(void);
+
+#endif
@@ -0,0 +1,15 @@
+/** @file */
+
+#ifndef SUDOKU_BITS_H
+#define SUDOKU_BITS_H
+
+#include <stddef.h>
+
+/** cells per board, padded to a whole number of 256-bit vectors */
+#define SUDOKU_BITS_CELLS 96
+
+int         sudoku_bits_solve(const char *puzzle, char *buf);
+size_t      sudoku_bits_nsolve(const char *puzzle, char *buf, size_t n);
+const char  *sudoku_bits_kernel(void);
+
+#endif
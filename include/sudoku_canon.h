@@ -0,0 +1,50 @@
+/** @file */
+
+#ifndef SUDOKU_CANON_H
+#define SUDOKU_CANON_H
+
+#include <stddef.h>
+#include "sudoku.h"
+
+/** @brief A symmetry of the sudoku grid together with a digit relabelling. */
+typedef struct {
+    unsigned char cells[81];    /**< cell i of the image is cell cells[i] */
+    unsigned char digits[10];   /**< digit d becomes digits[d]; 0 is blank */
+} sudoku_transform;
+
+int  sudoku_canonicalize(const char *puzzle, char *canon, sudoku_transform *t);
+void sudoku_transform_apply(const sudoku_transform *t, const char *src,
+                            char *dst);
+void sudoku_transform_invert(const sudoku_transform *t, const char *src,
+                             char *dst);
+
+typedef struct {
+    char    key[81];        /**< canonical puzzle */
+    char    solution[81];   /**< solution of key, if nsolutions > 0 */
+    int     nsolutions;     /**< 0, 1, or 2 meaning more than one */
+    unsigned long hash;
+    int     hnext;          /**< next entry in the same hash bucket */
+    int     prev;           /**< more recently used neighbour */
+    int     next;           /**< less recently used neighbour */
+} sudoku_cache_entry;
+
+/** @brief Bounded LRU cache of solutions keyed by canonical puzzle. */
+typedef struct {
+    sudoku_cache_entry  *entries;
+    int         *buckets;   /**< hash bucket heads, -1 if empty */
+    size_t      nbuckets;   /**< a power of 2 */
+    size_t      size;       /**< capacity in entries */
+    size_t      used;
+    int         head;       /**< most recently used entry, -1 if empty */
+    int         tail;       /**< least recently used entry */
+    unsigned long hits;
+    unsigned long misses;
+    sudoku_dlx  *puzzle_dlx;    /**< solver context for misses */
+} sudoku_cache;
+
+int     sudoku_cache_init(sudoku_cache *cache, size_t size);
+void    sudoku_cache_free(sudoku_cache *cache);
+int     sudoku_cache_nsolve(sudoku_cache *cache, const char *puzzle,
+                            char *buf);
+
+#endif
@@ -1,18 +1,45 @@
 #ifndef SUDOKU_GRID_H
 #define SUDOKU_GRID_H
 
+#include "sudoku.h"
+
 typedef struct {
     unsigned char val;
     unsigned char flags;
 } SudokuCell;
 
+/*
+ * Units are numbered as in sudoku.c: rows 0 - 8, columns 9 - 17, then
+ * regions 18 - 26.  Digit n is bit n - 1 of a mask.  The solution is only
+ * known in fixed mode, once set_solution has been given it; until then
+ * solution is empty and no entry counts as wrong.
+ */
 typedef struct SudokuGrid {
     int flags;
     int undo_list[81];
     int undo_pos;
     SudokuCell cells[81];
+    unsigned char count[27][9];     /**< times each digit is in each unit */
+    unsigned short used[27];        /**< digits in each unit, as a mask */
+    int conflicts;      /**< (unit, digit) pairs with the digit twice */
+    int wrong;          /**< filled cells that differ from solution */
+    char solution[82];
 } SudokuGrid;
 
+/**
+ * @brief A placement find_hint found, or the mistake it found instead.
+ * The technique is the constraint type of the DLX column with fewest
+ * choices left: CELL_ID for a naked single (val is the only digit left for
+ * cell), ROW_ID, COL_ID or REGION_ID for a hidden single (cell is the only
+ * place left for val in that unit).
+ */
+typedef struct {
+    constraint_type technique;
+    int cell;       /**< 0 - 80, in puzzle string order, or -1 */
+    int unit;       /**< 0 - 26 for hidden singles, else -1 */
+    int val;        /**< '1' - '9', or ' ' if there is none */
+} SudokuHint;
+
 void init_board(SudokuGrid *board);
 
 char *get_values(SudokuGrid *board, char values[]);
@@ -27,4 +54,11 @@ int  is_cell_fixed(SudokuGrid *board, int r, int c);
 int undo_board(SudokuGrid *board);
 void clear_board(SudokuGrid *board);
 
+void set_solution(SudokuGrid *board, const char *solution);
+int  is_cell_wrong(SudokuGrid *board, int r, int c);
+int  is_cell_conflict(SudokuGrid *board, int r, int c);
+
+int find_hint(SudokuGrid *board, SudokuHint *hint);
+int hint_unit_cells(const SudokuHint *hint, int cells[]);
+
 #endif
@@ -0,0 +1,27 @@
+/** @file */
+
+#ifndef SUDOKU_PACK_H
+#define SUDOKU_PACK_H
+
+#include <stdio.h>
+
+#define PACKED_PUZZLE_SIZE   41     /**< 81 cells at 4 bits each */
+#define PACKED_SOLUTION_SIZE 19     /**< 8 row permutation ranks at 19 bits */
+#define PACKED_HEADER_SIZE   8
+
+/** @brief record kinds, or'ed together in the stream header */
+#define PACK_PUZZLE     0x01
+#define PACK_SOLUTION   0x02
+
+void pack_puzzle(unsigned char out[], const char *puzzle);
+void unpack_puzzle(char *puzzle, const unsigned char in[]);
+int  pack_solution(unsigned char out[], const char *solution);
+int  unpack_solution(char *solution, const unsigned char in[]);
+void pack_no_solution(unsigned char out[]);
+
+int  pack_write_header(FILE *f, int kind);
+int  pack_read_header(FILE *f);
+int  pack_write(FILE *f, int kind, const char *puzzle, const char *solution);
+int  pack_read(FILE *f, int kind, char *puzzle, char *solution);
+
+#endif
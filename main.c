@@ -3,36 +3,305 @@
 #include <unistd.h>
 #include <string.h>
 #include "sudoku.h"
+#include "corpus.h"
+#include "sudoku_pack.h"
+#include "sudoku_canon.h"
+#include "sudoku_bits.h"
+#include "sudoku_batch.h"
+#include "server.h"
 
-static const char *optstring = "vc:";
+#define BATCH_SLICE 256     /* puzzles taken from the corpus at a time */
+
+/** @brief solver used for plain solves and counts, see -e */
+typedef enum {
+    ENGINE_DLX,
+    ENGINE_BITS,
+    ENGINE_BATCH
+} engine;
+
+static const char *optstring = "vabc:f:C:d:e:l:E:";
 
 static int      g_verbose_flag = 0;
+static int      g_all_flag     = 0;
 static size_t   g_count        = 0;
+static const char *g_corpus    = NULL;
+static int      g_packed_flag  = 0;
+static size_t   g_cache_size   = 0;
+static const char *g_socket    = NULL;
+static engine   g_engine       = ENGINE_DLX;
+static unsigned long g_budget  = 0;
+static unsigned long g_probes  = 0;
 
 static void usage(int argc, char *argv[])
 {
     fprintf(stdout,
 
-"USAGE: %s [-n count] < {puzzle} \n\n"
+"USAGE: %s [-n count] [-e engine] [-l nodes] < {puzzle} \n"
+"       %s -a [-b] [-c count] [-v] < {puzzle}\n"
+"       %s -f {file | -} [-b] [-c count] [-C size] [-e engine]\n"
+"\t\t[-l nodes] [-v]\n"
+"       %s -E probes [-l nodes] < {puzzle}\n"
+"       %s -d socket [-l nodes] [-v]\n\n"
+
+            , argv[0], argv[0], argv[0], argv[0], argv[0]);
+    fputs(
 
 "OPTIONS\n"
+"  -a\t\tprint every solution, one per line.  With -c, stop after\n"
+"\t\tc solutions\n"
+"  -b\t\twith -a or -f, write packed binary records instead of text\n"
+"\t\t(see sudoku/sudoku_pack.c)\n"
 "  -c count\tcheck for up to c solutions before returning one\n"
 "\t\tReturns 2 if more than one solution found.\n"
 "\t\tWith -v, print number of solutions found (up to c) to stderr\n"
+
+            , stdout);
+    fputs(
+
+"  -C size\twith -f, remember the results for up to size puzzles,\n"
+"\t\tincluding relabelled, rotated or transposed copies.  The\n"
+"\t\tcache solves with dlx, so it does not take another -e\n"
+
+            , stdout);
+    fputs(
+
+"  -d socket\tserve solve (S), count (C) and hint (H) requests on the\n"
+"\t\tUnix domain socket, one per line (see server/server.c)\n"
+"  -e engine\tsolve with engine: dlx (the default); bits, the SIMD\n"
+"\t\tbitboard solver in sudoku/sudoku_bits.c; or, with -f, batch,\n"
+"\t\twhich propagates 16 puzzles at a time (sudoku/sudoku_batch.c)\n"
+
+            , stdout);
+    fputs(
+
+"  -E probes\testimate the number of solutions, and the search nodes\n"
+"\t\tneeded to count them, from this many random probes of the\n"
+"\t\tsearch tree, with 95% confidence intervals\n"
+"  -f file\tsolve every puzzle in file (- for standard input), one\n"
+"\t\tpuzzle per line, printing one solution per line.  Unsolvable\n"
+"\t\tpuzzles (and, with -c, puzzles with more than one solution)\n"
+"\t\tget an empty line.  Lines shorter than 81 characters are\n"
+"\t\tskipped.\n"
+
+            , stdout);
+    fputs(
+
+"  -l nodes\tgive up on a DLX search after this many search nodes:\n"
+"\t\texit with status 3, print an empty line for the puzzle with\n"
+"\t\t-f, or answer \"ERR budget exhausted\" with -d.  Only the\n"
+"\t\tdlx engine has a budget, so not with another -e, or -C\n"
 "  -v\t\tSubject to change in the future; for now,\n"
-"\t\tonly affects output when combined with -c\n"
+"\t\tonly affects output when combined with -c or -f\n"
 
 "\nStandard Input\n"
 "\t\tA single sudoku puzzle in the format of an 81 character string\n"
 "\t\tis read from standard input.\n"
 
-            , argv[0]);
+            , stdout);
+}
+
+/**
+ * @brief Solve puzzle on puzzle_dlx, counting up to g_count solutions if
+ * g_count is set, and giving up after g_budget search nodes if that is set.
+ * @return number of solutions found (at most 1 without g_count), or
+ *         DLX_EXHAUSTED
+ */
+static size_t solve_dlx(sudoku_dlx *puzzle_dlx, const char *puzzle,
+                        char *solution)
+{
+    dlx_ctl ctl, *limit = NULL;
+
+    if (sudoku_load_givens(puzzle_dlx, puzzle) < 0)
+        return 0;
+    if (g_budget != 0) {
+        dlx_ctl_init(&ctl);
+        ctl.budget = g_budget;
+        limit = &ctl;
+    }
+    if (g_count > 0)
+        return sudoku_dlx_nsolve_ctl(puzzle_dlx, solution, g_count, limit);
+    switch (sudoku_dlx_solve_ctl(puzzle_dlx, solution, limit)) {
+        case -1:
+            return DLX_EXHAUSTED;
+        case 0:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Solve every puzzle in the corpus at path, writing one line per
+ * puzzle to stdout.
+ * @return number of puzzles that were not solved, or -1 if path could not be
+ *         opened
+ */
+static long solve_corpus(const char *path)
+{
+    corpus      cp;
+    sudoku_dlx  *puzzle_dlx;
+    sudoku_cache cache;
+    const char  *puzzles[BATCH_SLICE];
+    char        solution[82];
+    char        solutions[BATCH_SLICE][82];
+    size_t      counts[BATCH_SLICE];
+    size_t      i, n, ok, found;
+    unsigned long total = 0, failed = 0, searched = 0, exhausted = 0;
+
+    if (corpus_open(&cp, path) != 0)
+        return -1;
+    if ((puzzle_dlx = malloc(sizeof(*puzzle_dlx))) == NULL) {
+        corpus_close(&cp);
+        return -1;
+    }
+    if (g_cache_size > 0 && sudoku_cache_init(&cache, g_cache_size) != 0) {
+        free(puzzle_dlx);
+        corpus_close(&cp);
+        return -1;
+    }
+    sudoku_dlx_init(puzzle_dlx);
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    if (g_packed_flag)
+        pack_write_header(stdout, PACK_PUZZLE | PACK_SOLUTION);
+
+    while ((n = corpus_next_slice(&cp, puzzles, BATCH_SLICE)) > 0) {
+        if (g_engine == ENGINE_BATCH)
+            searched += sudoku_batch_nsolve(puzzle_dlx, puzzles, solutions,
+                                            counts, n, g_count ? g_count : 1);
+        for (i = 0; i < n; i++) {
+            ok = 0;
+            if (g_cache_size > 0) {
+                /* the cache only counts up to 2 solutions */
+                ok = sudoku_cache_nsolve(&cache, puzzles[i], solution);
+                ok = g_count > 1 ? ok == 1 : ok > 0;
+            } else if (g_engine == ENGINE_BATCH) {
+                ok = g_count > 0 ? counts[i] == 1 : counts[i] > 0;
+                if (ok)
+                    memcpy(solution, solutions[i], sizeof(solution));
+            } else if (g_engine == ENGINE_BITS) {
+                if (g_count > 0)
+                    ok = sudoku_bits_nsolve(puzzles[i], solution, g_count) == 1;
+                else
+                    ok = sudoku_bits_solve(puzzles[i], solution);
+            } else if ((found = solve_dlx(puzzle_dlx, puzzles[i], solution))
+                       == DLX_EXHAUSTED) {
+                exhausted++;
+            } else {
+                ok = found == 1;
+            }
+            if (!ok)
+                failed++;
+            if (g_packed_flag) {
+                pack_write(stdout, PACK_PUZZLE | PACK_SOLUTION, puzzles[i],
+                           ok ? solution : NULL);
+            } else {
+                if (ok)
+                    fputs(solution, stdout);
+                putchar('\n');
+            }
+        }
+        total += n;
+    }
+
+    if (g_verbose_flag) {
+        fprintf(stderr, "%lu puzzles, %lu not solved\n", total, failed);
+        if (g_budget != 0)
+            fprintf(stderr, "%lu over the search budget\n", exhausted);
+        if (g_engine == ENGINE_BITS)
+            fprintf(stderr, "bits kernel: %s\n", sudoku_bits_kernel());
+        if (g_engine == ENGINE_BATCH)
+            fprintf(stderr, "batch kernel: %s, %lu puzzles searched\n",
+                    sudoku_batch_kernel(), searched);
+    }
+    if (g_cache_size > 0) {
+        if (g_verbose_flag)
+            fprintf(stderr, "cache: %lu hits, %lu misses\n",
+                    cache.hits, cache.misses);
+        sudoku_cache_free(&cache);
+    }
+
+    free(puzzle_dlx);
+    corpus_close(&cp);
+    return failed;
+}
+
+/**
+ * @brief Write every solution of puzzle to stdout, stopping after g_count
+ * solutions if g_count is set.
+ * @return number of solutions written, or -1 if out of memory
+ */
+static long solve_all(const char *puzzle)
+{
+    sudoku_dlx  *puzzle_dlx;
+    sudoku_iter si;
+    const char  *solution;
+    unsigned long n = 0;
+
+    if ((puzzle_dlx = malloc(sizeof(*puzzle_dlx))) == NULL)
+        return -1;
+    sudoku_dlx_init(puzzle_dlx);
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    if (g_packed_flag)
+        pack_write_header(stdout, PACK_SOLUTION);
+
+    if (sudoku_load_givens(puzzle_dlx, puzzle) >= 0) {
+        sudoku_iter_init(&si, puzzle_dlx);
+        while ((g_count == 0 || n < g_count)
+                && (solution = sudoku_iter_next(&si)) != NULL) {
+            if (g_packed_flag) {
+                pack_write(stdout, PACK_SOLUTION, NULL, solution);
+            } else {
+                fwrite(solution, 81, 1, stdout);
+                putchar('\n');
+            }
+            n++;
+        }
+        sudoku_iter_abort(&si);
+    }
+
+    if (g_verbose_flag)
+        fprintf(stderr, "%lu\n", n);
+    free(puzzle_dlx);
+    return n;
+}
+
+/**
+ * @brief Print estimates of the number of solutions of puzzle and of the
+ * cost of counting them, from g_probes random probes.
+ * @return 0, or -1 if out of memory
+ */
+static int estimate(const char *puzzle)
+{
+    sudoku_dlx  *puzzle_dlx;
+    dlx_ctl     ctl;
+    dlx_est     est;
+
+    if ((puzzle_dlx = malloc(sizeof(*puzzle_dlx))) == NULL)
+        return -1;
+    sudoku_dlx_init(puzzle_dlx);
+    dlx_ctl_init(&ctl);
+    ctl.budget = g_budget;
+
+    if (sudoku_load_givens(puzzle_dlx, puzzle) < 0) {
+        est.probes = 0;
+        est.solutions = est.solutions_ci = 0;
+        est.nodes = est.nodes_ci = 0;
+    } else {
+        sudoku_dlx_estimate(puzzle_dlx, g_probes, &ctl, &est);
+    }
+    printf("solutions %.4g +- %.2g\n", est.solutions, est.solutions_ci);
+    printf("nodes %.4g +- %.2g\n", est.nodes, est.nodes_ci);
+    printf("probes %lu\n", est.probes);
+
+    free(puzzle_dlx);
+    return 0;
 }
 
 int main(int argc, char *argv[])
 {
     int     c;
     size_t  n;
+    sudoku_dlx *puzzle_dlx;
     char    puzzle[82];
     char    solution[82];
 
@@ -44,6 +313,39 @@ int main(int argc, char *argv[])
             case 'v':
                 g_verbose_flag = 1;
                 break;
+            case 'a':
+                g_all_flag = 1;
+                break;
+            case 'f':
+                g_corpus = optarg;
+                break;
+            case 'b':
+                g_packed_flag = 1;
+                break;
+            case 'C':
+                g_cache_size = atoi(optarg);
+                break;
+            case 'd':
+                g_socket = optarg;
+                break;
+            case 'E':
+                g_probes = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                g_budget = strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                if (strcmp(optarg, "dlx") == 0) {
+                    g_engine = ENGINE_DLX;
+                } else if (strcmp(optarg, "bits") == 0) {
+                    g_engine = ENGINE_BITS;
+                } else if (strcmp(optarg, "batch") == 0) {
+                    g_engine = ENGINE_BATCH;
+                } else {
+                    usage(argc, argv);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case '?':
                 usage(argc, argv);
                 exit(EXIT_FAILURE);
@@ -51,6 +353,31 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* the cache solves its misses with DLX, and only DLX keeps a budget */
+    if ((g_engine != ENGINE_DLX && (g_cache_size > 0 || g_budget != 0))
+            || (g_cache_size > 0 && g_budget != 0)) {
+        usage(argc, argv);
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_socket != NULL) {
+        server_run(g_socket, g_verbose_flag, g_budget);
+        perror(g_socket);
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_corpus != NULL) {
+        switch (solve_corpus(g_corpus)) {
+            case -1:
+                perror(g_corpus);
+                exit(EXIT_FAILURE);
+            case 0:
+                exit(EXIT_SUCCESS);
+            default:
+                exit(2);
+        }
+    }
+
     for (c = 0; c < 82; c++)    /* just to be safe when calling strlen */
         puzzle[c] = '\0';
 
@@ -67,15 +394,51 @@ int main(int argc, char *argv[])
     }
 
     /* read successful, now process puzzle */
-    if (g_count > 0) {
-        n = sudoku_nsolve(puzzle, solution, g_count);
+    if (g_probes > 0) {
+        if (estimate(puzzle) != 0) {
+            perror(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    if (g_all_flag) {
+        switch (solve_all(puzzle)) {
+            case -1:
+                perror(argv[0]);
+                exit(EXIT_FAILURE);
+            case 0:
+                exit(EXIT_FAILURE);
+            default:
+                exit(EXIT_SUCCESS);
+        }
+    }
+
+    if (g_engine == ENGINE_BITS) {
+        if (g_count > 0)
+            n = sudoku_bits_nsolve(puzzle, solution, g_count);
+        else
+            n = sudoku_bits_solve(puzzle, solution);
+    } else if ((puzzle_dlx = malloc(sizeof(*puzzle_dlx))) != NULL) {
+        sudoku_dlx_init(puzzle_dlx);
+        n = solve_dlx(puzzle_dlx, puzzle, solution);
+        free(puzzle_dlx);
+    } else {
+        perror(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (n == DLX_EXHAUSTED) {
+        if (g_verbose_flag)
+            fprintf(stderr, "Search budget exhausted.\n");
+        exit(3);
+    } else if (g_count > 0) {
         if (g_verbose_flag)
             fprintf(stderr, "%lu\n", (unsigned long) n);
         if (n > 0)
             printf("%s\n", solution);
         exit(2);
     } else {
-        if (sudoku_solve(puzzle, solution)) {
+        if (n > 0) {
             printf("%s\n", solution);
             exit(EXIT_SUCCESS);
         } else {
@@ -0,0 +1,757 @@
+/**
+ * @file
+ * @brief General exact cover problems: building them item by item and option
+ * by option, and reading and writing them as files.
+ *
+ * The text format is the one Knuth's dlx1 reads.  Lines starting with '|' are
+ * comments.  The first other line names the items, separated by spaces;
+ * items after a lone '|' are secondary.  Every following line is an option,
+ * listing the items it covers.  Names are up to DLX_NAME_MAX printable
+ * characters, without ':' or '|'.  For example, the matrix of test.c:
+ *
+ *     | Knuth's example
+ *     a b c d e f g
+ *     c e f
+ *     a d g
+ *     b c f
+ *     a d
+ *     b g
+ *     d e g
+ *
+ * The binary format holds the same thing, with items numbered instead of
+ * named in the options.  It starts with a NUL byte and "DLX", so it can never
+ * be mistaken for text.  Everything after that is an unsigned LEB128 number
+ * (7 bits per byte, low bits first, the top bit set on all bytes but the
+ * last):
+ *
+ *     version (1), items, primary items, options, nodes
+ *     for each item:   length of name, then that many bytes of it
+ *     for each option: number of items, then the index of each
+ *
+ * The node count up front lets the reader put every option into one block.
+ * Options are linked in as they are read, into blocks of DLX_ARENA_NODES
+ * nodes, so the file is never held in memory as a whole.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "dlx_file.h"
+
+#define BINARY_VERSION  1
+
+/**
+ * @name GROUP_DLX_PROBLEM
+ * Building a dlx_problem.
+ * @{
+ */
+
+/** @brief Leave p with nothing allocated, so dlx_problem_free can be called */
+static void clear(dlx_problem *p)
+{
+    p->items    = NULL;
+    p->names    = NULL;
+    p->nitems   = 0;
+    p->nprimary = 0;
+    p->options  = NULL;
+    p->noptions = 0;
+    p->nnodes   = 0;
+    p->capacity = 0;
+    p->last     = NULL;
+    p->arena    = NULL;
+    p->block    = DLX_ARENA_NODES;
+    p->cols     = NULL;
+    p->line     = 0;
+    p->error    = NULL;
+}
+
+/**
+ * @brief Link the root and the primary items into the header list, and
+ * give each secondary item a list of its own.
+ */
+static void link_items(dlx_problem *p)
+{
+    node *h = (node *) &p->root;
+    node *prev = h;
+    node *c;
+    size_t i;
+
+    h->up        = NULL;
+    h->down      = NULL;
+    h->chead     = NULL;
+    p->root.s    = 0;
+    p->root.id   = NULL;
+
+    for (i = 0; i < p->nitems; i++) {
+        c = (node *) (p->items + i);
+        c->up    = c;
+        c->down  = c;
+        c->chead = p->items + i;
+        p->items[i].s  = 0;
+        p->items[i].id = p->names[i];
+        if (i < p->nprimary) {
+            c->left     = prev;
+            prev->right = c;
+            prev        = c;
+        } else {
+            c->left  = c;
+            c->right = c;
+        }
+    }
+    prev->right = h;
+    h->left     = prev;
+}
+
+/**
+ * @brief Set p up as a problem with nitems items and no options yet.  The
+ * names are all empty; fill in p->names[i] before using them.
+ *
+ * @param nprimary  items[0 .. nprimary - 1] are primary, the rest secondary
+ * @param nnodes    total size of the options to come, if known, so that
+ *                  they can go in one block; 0 if not
+ * @return 0 on success, -1 if out of memory
+ */
+int dlx_problem_init(dlx_problem *p, size_t nitems, size_t nprimary,
+                     size_t nnodes)
+{
+    clear(p);
+    p->nitems   = nitems;
+    p->nprimary = nprimary < nitems ? nprimary : nitems;
+    if (nnodes > 0)
+        p->block = nnodes;
+
+    /* one extra of each, so that no size is 0 */
+    p->items = malloc((nitems + 1) * sizeof(*p->items));
+    p->names = calloc(nitems + 1, sizeof(*p->names));
+    p->last  = calloc(nitems + 1, sizeof(*p->last));
+    p->cols  = malloc((nitems + 1) * sizeof(*p->cols));
+    if (p->items == NULL || p->names == NULL || p->last == NULL
+            || p->cols == NULL) {
+        dlx_problem_free(p);
+        p->error = "out of memory";
+        return -1;
+    }
+    link_items(p);
+    return 0;
+}
+
+/** @return room for n more nodes in p's arena, or NULL if out of memory */
+static node *alloc_nodes(dlx_problem *p, size_t n)
+{
+    dlx_block *b = p->arena;
+    size_t size;
+
+    if (b == NULL || b->size - b->used < n) {
+        size = p->block > n ? p->block : n;
+        b = malloc(sizeof(*b) + (size - 1) * sizeof(b->nodes[0]));
+        if (b == NULL)
+            return NULL;
+        b->next  = p->arena;
+        b->used  = 0;
+        b->size  = size;
+        p->arena = b;
+        p->block = DLX_ARENA_NODES;
+    }
+    b->used += n;
+    return b->nodes + b->used - n;
+}
+
+/**
+ * @brief Add an option covering the n items whose indices are in items[], in
+ * that order.  At least one of them must be primary, and none may repeat.
+ * @return 0 on success, -1 with p->error set otherwise
+ */
+int dlx_problem_add_option(dlx_problem *p, const int items[], size_t n)
+{
+    node **options;
+    node *nodes;
+    size_t i, k, primary = 0;
+
+    if (n == 0 || n > p->nitems) {
+        p->error = n == 0 ? "empty option" : "item repeated in option";
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        if (items[i] < 0 || (size_t) items[i] >= p->nitems) {
+            p->error = "no such item";
+            return -1;
+        }
+        k = items[i];
+        if (p->last[k] == p->noptions + 1) {
+            p->error = "item repeated in option";
+            return -1;
+        }
+        p->last[k] = p->noptions + 1;
+        primary += k < p->nprimary;
+        p->cols[i] = items[i];
+    }
+    if (primary == 0) {
+        p->error = "option has no primary item";
+        return -1;
+    }
+
+    if (p->noptions == p->capacity) {
+        k = p->capacity > 0 ? 2 * p->capacity : 256;
+        if ((options = realloc(p->options, k * sizeof(*options))) == NULL) {
+            p->error = "out of memory";
+            return -1;
+        }
+        p->options  = options;
+        p->capacity = k;
+    }
+    if ((nodes = alloc_nodes(p, n)) == NULL) {
+        p->error = "out of memory";
+        return -1;
+    }
+
+    dlx_make_row(nodes, p->items, p->cols, n);
+    p->options[p->noptions++] = nodes;
+    p->nnodes += n;
+    return 0;
+}
+
+/**
+ * @brief Make dst an identical copy of src, with the same items and options
+ * in the same order, so that a search on one can be repeated on the other
+ * (see dlx_portfolio and dlx_count_parallel).  src must not be in the middle
+ * of a search.
+ * @return 0 on success, -1 with dst->error set if out of memory
+ */
+int dlx_problem_copy(dlx_problem *dst, const dlx_problem *src)
+{
+    size_t i, n;
+    node *j;
+
+    if (dlx_problem_init(dst, src->nitems, src->nprimary, src->nnodes) < 0)
+        return -1;
+    memcpy(dst->names, src->names, src->nitems * sizeof(*src->names));
+    for (i = 0; i < src->noptions; i++) {
+        n = 0;
+        j = src->options[i];
+        do {
+            dst->cols[n++] = dlx_item_index(src, j->chead);
+        } while ((j = j->right) != src->options[i]);
+        if (dlx_problem_add_option(dst, dst->cols, n) < 0) {
+            dlx_problem_free(dst);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Move p's options into a single block in traversal order (see
+ * dlx_compact), so that walking a column goes forward through memory
+ * instead of hopping between options added far apart.  p->options keeps
+ * the options in the order they were added, and p must not be in the
+ * middle of a search.
+ * @return 0 on success, -1 with p->error set if out of memory
+ */
+int dlx_problem_compact(dlx_problem *p)
+{
+    dlx_block *b, *old = p->arena;
+    size_t i;
+
+    b = malloc(sizeof(*b) + p->nnodes * sizeof(b->nodes[0]));
+    if (b == NULL) {
+        p->error = "out of memory";
+        return -1;
+    }
+    b->next = NULL;
+    b->used = dlx_compact(&p->root, b->nodes);
+    b->size = b->used;
+    for (i = 0; i < p->noptions; i++)
+        p->options[i] = p->options[i]->left;
+    while (old != NULL) {
+        p->arena = old->next;
+        free(old);
+        old = p->arena;
+    }
+    p->arena = b;
+    return 0;
+}
+
+/** @brief Free everything p holds; p->error and p->line are kept. */
+void dlx_problem_free(dlx_problem *p)
+{
+    dlx_block *b;
+    const char *error = p->error;
+    size_t line = p->line;
+
+    while ((b = p->arena) != NULL) {
+        p->arena = b->next;
+        free(b);
+    }
+    free(p->items);
+    free(p->names);
+    free(p->options);
+    free(p->last);
+    free(p->cols);
+    clear(p);
+    p->error = error;
+    p->line  = line;
+}
+
+/** @return index in p->items of item, a column header of p */
+size_t dlx_item_index(const dlx_problem *p, const hnode *item)
+{
+    return item - p->items;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_TEXT
+ * Knuth's dlx1 text format.
+ * @{
+ */
+
+/**
+ * @brief Read a line of f into *buf, growing it as needed, without the
+ * newline.
+ * @return 0, or -1 at end of file or if out of memory
+ */
+static int read_line(FILE *f, char **buf, size_t *cap, dlx_problem *p)
+{
+    size_t n = 0;
+    char *b;
+    int c;
+
+    while ((c = getc(f)) != EOF && c != '\n') {
+        if (n + 1 >= *cap) {
+            if ((b = realloc(*buf, *cap * 2 + 128)) == NULL) {
+                p->error = "out of memory";
+                return -1;
+            }
+            *buf = b;
+            *cap = *cap * 2 + 128;
+        }
+        (*buf)[n++] = c;
+    }
+    if (c == EOF && n == 0)
+        return -1;
+    if (*buf == NULL && (*buf = malloc(*cap = 128)) == NULL) {
+        p->error = "out of memory";
+        return -1;
+    }
+    (*buf)[n] = '\0';
+    p->line++;
+    return 0;
+}
+
+/**
+ * @brief Split the next whitespace separated token off *s, in place.
+ * @return the token, or NULL if only whitespace is left
+ */
+static char *next_token(char **s)
+{
+    char *t = *s;
+
+    while (isspace((unsigned char) *t))
+        t++;
+    if (*t == '\0')
+        return NULL;
+    for (*s = t; **s != '\0' && !isspace((unsigned char) **s); (*s)++)
+        ;
+    if (**s != '\0')
+        *(*s)++ = '\0';
+    return t;
+}
+
+/** @return 1 if t is a valid item name */
+static int valid_name(const char *t)
+{
+    size_t n;
+
+    for (n = 0; t[n] != '\0'; n++)
+        if (!isgraph((unsigned char) t[n]) || t[n] == ':' || t[n] == '|')
+            return 0;
+    return n > 0 && n <= DLX_NAME_MAX;
+}
+
+/**
+ * @brief Append name to the growing array *names of *n names.
+ * @return 0, or -1 with p->error set if name is bad or out of memory
+ */
+static int add_name(dlx_problem *p, char (**names)[DLX_NAME_MAX + 1],
+                    size_t *n, size_t *room, const char *name)
+{
+    char (*grown)[DLX_NAME_MAX + 1];
+
+    if (!valid_name(name)) {
+        p->error = "bad item name";
+        return -1;
+    }
+    if (*n == *room) {
+        *room = *room > 0 ? 2 * *room : 64;
+        if ((grown = realloc(*names, *room * sizeof(**names))) == NULL) {
+            p->error = "out of memory";
+            return -1;
+        }
+        *names = grown;
+    }
+    strcpy((*names)[(*n)++], name);
+    return 0;
+}
+
+/**
+ * @brief Set p up with the n names collected by add_name, which are freed.
+ * @return 0, or -1 with p->error set
+ */
+static int init_named(dlx_problem *p, char (*names)[DLX_NAME_MAX + 1],
+                      size_t n, size_t nprimary, size_t nnodes)
+{
+    size_t line = p->line;
+
+    if (dlx_problem_init(p, n, nprimary, nnodes) < 0) {
+        free(names);
+        return -1;
+    }
+    p->line = line;
+    if (n > 0)
+        memcpy(p->names, names, n * sizeof(*names));
+    free(names);
+    return 0;
+}
+
+/** @brief FNV-1a hash of a name */
+static unsigned long hash_name(const char *s)
+{
+    unsigned long h = 2166136261UL;
+
+    while (*s != '\0')
+        h = ((h ^ (unsigned char) *s++) * 16777619UL) & 0xffffffffUL;
+    return h;
+}
+
+/**
+ * @brief Find name in the open addressing table of item indices plus 1,
+ * which has mask + 1 slots.
+ * @return slot of name, or of the empty slot where it would go
+ */
+static size_t find_name(const dlx_problem *p, const size_t *table,
+                        size_t mask, const char *name)
+{
+    size_t i = hash_name(name) & mask;
+
+    while (table[i] != 0 && strcmp(p->names[table[i] - 1], name) != 0)
+        i = (i + 1) & mask;
+    return i;
+}
+
+/**
+ * @brief Make the table find_name looks names up in, with *mask set.
+ * @return the table, or NULL with p->error set if out of memory or if a
+ *          name is used twice
+ */
+static size_t *name_table(dlx_problem *p, size_t *mask)
+{
+    size_t *table;
+    size_t i, n;
+
+    for (*mask = 1; *mask < 2 * p->nitems; *mask = 2 * *mask + 1)
+        ;
+    if ((table = calloc(*mask + 1, sizeof(*table))) == NULL) {
+        p->error = "out of memory";
+        return NULL;
+    }
+    for (n = 0; n < p->nitems; n++) {
+        if (table[i = find_name(p, table, *mask, p->names[n])] != 0) {
+            p->error = "item listed twice";
+            free(table);
+            return NULL;
+        }
+        table[i] = n + 1;
+    }
+    return table;
+}
+
+/** @brief Read the text format, up to the options. */
+static int read_items(dlx_problem *p, FILE *f, char **buf, size_t *cap)
+{
+    char (*names)[DLX_NAME_MAX + 1] = NULL;
+    size_t n = 0, room = 0, nprimary = (size_t) -1;
+    char *s, *tok;
+
+    /* the first line that is not a comment or blank names the items */
+    do {
+        if (read_line(f, buf, cap, p) < 0) {
+            if (p->error == NULL)
+                p->error = "no items";
+            return -1;
+        }
+        s = *buf;
+    } while (**buf == '|' || (tok = next_token(&s)) == NULL);
+
+    for (; tok != NULL; tok = next_token(&s)) {
+        if (strcmp(tok, "|") == 0) {
+            if (nprimary != (size_t) -1) {
+                p->error = "more than one | in items";
+                free(names);
+                return -1;
+            }
+            nprimary = n;
+            continue;
+        }
+        if (add_name(p, &names, &n, &room, tok) < 0) {
+            free(names);
+            return -1;
+        }
+    }
+    if (nprimary == (size_t) -1)
+        nprimary = n;
+    if (nprimary == 0) {
+        p->error = "no primary items";
+        free(names);
+        return -1;
+    }
+    return init_named(p, names, n, nprimary, 0);
+}
+
+/** @brief Read a text format problem; the item names are known from f. */
+static int read_text(dlx_problem *p, FILE *f)
+{
+    char    *buf = NULL;
+    char    *s, *tok;
+    size_t  cap = 0, mask, i, n;
+    size_t  *table = NULL;
+    int     *cols = NULL;
+
+    if (read_items(p, f, &buf, &cap) < 0
+            || (table = name_table(p, &mask)) == NULL)
+        goto fail;
+    if ((cols = malloc((p->nitems + 1) * sizeof(*cols))) == NULL) {
+        p->error = "out of memory";
+        goto fail;
+    }
+
+    while (read_line(f, &buf, &cap, p) == 0) {
+        if (*buf == '|')
+            continue;
+        s = buf;
+        for (n = 0; (tok = next_token(&s)) != NULL; n++) {
+            if (table[i = find_name(p, table, mask, tok)] == 0) {
+                p->error = "unknown item";
+                goto fail;
+            }
+            if (n == p->nitems) {
+                p->error = "item repeated in option";
+                goto fail;
+            }
+            cols[n] = table[i] - 1;
+        }
+        if (n > 0 && dlx_problem_add_option(p, cols, n) < 0)
+            goto fail;
+    }
+    if (p->error != NULL)
+        goto fail;
+    if (ferror(f)) {
+        p->error = "read error";
+        goto fail;
+    }
+
+    free(buf);
+    free(table);
+    free(cols);
+    return 0;
+
+fail:
+    free(buf);
+    free(table);
+    free(cols);
+    dlx_problem_free(p);
+    return -1;
+}
+
+/**
+ * @brief Write p in the text format.  Options are written in the order they
+ * were added, each with its items in order.  The links this reads are never
+ * changed by a search, so p may be in the middle of one.
+ * @return 0 on success, -1 on a write error or if p has no primary items,
+ *          which the text format cannot express
+ */
+int dlx_write_text(const dlx_problem *p, FILE *f)
+{
+    size_t i;
+    node *j;
+
+    if (p->nprimary == 0)
+        return -1;
+    for (i = 0; i < p->nitems; i++) {
+        if (i == p->nprimary)
+            fputs(" |", f);
+        fprintf(f, i > 0 ? " %s" : "%s", p->names[i]);
+    }
+    putc('\n', f);
+
+    for (i = 0; i < p->noptions; i++) {
+        j = p->options[i];
+        do {
+            fputs((const char *) j->chead->id, f);
+            putc((j = j->right) != p->options[i] ? ' ' : '\n', f);
+        } while (j != p->options[i]);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_BINARY
+ * The binary format.
+ * @{
+ */
+
+/** @return 0 with the next LEB128 number of f in *v, -1 if there is none */
+static int read_number(FILE *f, unsigned long *v)
+{
+    int c, shift = 0;
+
+    *v = 0;
+    do {
+        if ((c = getc(f)) == EOF || shift > 28)
+            return -1;
+        *v |= (unsigned long) (c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return 0;
+}
+
+/** @brief Write v to f as an LEB128 number */
+static void write_number(FILE *f, unsigned long v)
+{
+    while (v >= 0x80) {
+        putc((int) (v & 0x7f) | 0x80, f);
+        v >>= 7;
+    }
+    putc((int) v, f);
+}
+
+/** @brief Read a binary problem, after its first byte. */
+static int read_binary(dlx_problem *p, FILE *f)
+{
+    unsigned long version, nitems, nprimary, noptions, nnodes, len, v;
+    char (*names)[DLX_NAME_MAX + 1] = NULL;
+    char name[DLX_NAME_MAX + 1];
+    size_t i, k = 0, room = 0, mask;
+    size_t *table;
+
+    if (getc(f) != 'D' || getc(f) != 'L' || getc(f) != 'X'
+            || read_number(f, &version) < 0 || version != BINARY_VERSION) {
+        p->error = "not a binary problem file";
+        return -1;
+    }
+    if (read_number(f, &nitems) < 0 || read_number(f, &nprimary) < 0
+            || read_number(f, &noptions) < 0 || read_number(f, &nnodes) < 0)
+        goto truncated;
+    if (nprimary > nitems || nnodes > nitems * noptions) {
+        p->error = "bad counts";
+        return -1;
+    }
+
+    /* the names come first, so nothing is allocated for items, or options,
+     * that are not really there */
+    for (i = 0; i < nitems; i++) {
+        if (read_number(f, &len) < 0 || len > DLX_NAME_MAX
+                || fread(name, 1, len, f) != len) {
+            free(names);
+            goto truncated;
+        }
+        name[len] = '\0';
+        if (add_name(p, &names, &k, &room, name) < 0) {
+            free(names);
+            return -1;
+        }
+    }
+    if (init_named(p, names, nitems, nprimary, nnodes) < 0)
+        return -1;
+    if ((table = name_table(p, &mask)) == NULL)
+        goto fail;
+    free(table);
+
+    for (i = 0; i < noptions; i++) {
+        if (read_number(f, &len) < 0)
+            goto truncated;
+        if (len > nitems) {
+            p->error = "item repeated in option";
+            goto fail;
+        }
+        for (k = 0; k < len; k++) {
+            if (read_number(f, &v) < 0)
+                goto truncated;
+            p->cols[k] = v < nitems ? (int) v : -1;
+        }
+        if (dlx_problem_add_option(p, p->cols, len) < 0)
+            goto fail;
+    }
+    if (p->nnodes != nnodes) {
+        p->error = "wrong node count";
+        goto fail;
+    }
+    return 0;
+
+truncated:
+    p->error = ferror(f) ? "read error" : "truncated file";
+fail:
+    dlx_problem_free(p);
+    return -1;
+}
+
+/**
+ * @brief Write p in the binary format; like dlx_write_text, p may be in the
+ * middle of a search.
+ * @return 0 on success, -1 on a write error
+ */
+int dlx_write_binary(const dlx_problem *p, FILE *f)
+{
+    size_t i, n;
+    node *j;
+
+    fwrite("\0DLX", 1, 4, f);
+    write_number(f, BINARY_VERSION);
+    write_number(f, p->nitems);
+    write_number(f, p->nprimary);
+    write_number(f, p->noptions);
+    write_number(f, p->nnodes);
+
+    for (i = 0; i < p->nitems; i++) {
+        n = strlen(p->names[i]);
+        write_number(f, n);
+        fwrite(p->names[i], 1, n, f);
+    }
+
+    for (i = 0; i < p->noptions; i++) {
+        n = 0;
+        j = p->options[i];
+        do
+            n++;
+        while ((j = j->right) != p->options[i]);
+        write_number(f, n);
+        do {
+            write_number(f, dlx_item_index(p, j->chead));
+        } while ((j = j->right) != p->options[i]);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+/** @} */
+
+/**
+ * @brief Read a problem from f, in either format.
+ *
+ * On failure nothing is left allocated in p, p->error says what was wrong,
+ * and for a text file p->line is the line it was found on.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int dlx_read(dlx_problem *p, FILE *f)
+{
+    int c;
+
+    clear(p);
+    if ((c = getc(f)) == '\0')
+        return read_binary(p, f);
+    if (c != EOF)
+        ungetc(c, f);
+    return read_text(p, f);
+}
@@ -0,0 +1,439 @@
+/**
+ * @file
+ * @brief Generators of standard exact cover problems, for benchmarks and
+ * tests of the DLX core on something other than sudoku.
+ *
+ *  - dlx_gen_queens: n queens on an n x n board, one per row and column, at
+ *    most one per diagonal (the diagonals are secondary items).
+ *  - dlx_gen_pentominoes: the twelve pentominoes packed into a box of 60
+ *    cells, in every orientation.
+ *  - dlx_gen_langford: Langford pairs, two of each of 1 .. n in 2n slots
+ *    with k numbers between the two k's.
+ *  - dlx_gen_random: random options over n items, each item in an option
+ *    with a given probability, plus a hidden solution so there is one.
+ *
+ * The problems are built with dlx_problem_init and dlx_problem_add_option,
+ * so they can be written out with dlx_write_text like any other.  Item
+ * names follow Knuth's programs where there is one to follow.  On failure
+ * nothing is left allocated in p, and p->error says why.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dlx_gen.h"
+
+/**
+ * @name GROUP_DLX_GEN_QUEENS
+ * @{
+ */
+
+/**
+ * @brief n queens: items r0 .. and c0 .. for the rows and columns, and
+ * secondary a0 .. and b0 .. for the diagonals; option (r, c) covers ri, cj,
+ * a(i + j) and b(i - j + n - 1).
+ * @return 0, or -1 if n is out of range or out of memory
+ */
+int dlx_gen_queens(dlx_problem *p, int n)
+{
+    int r, c, d, cols[4];
+    size_t i;
+
+    if (n < 1 || n > 9999) {
+        p->error = "bad size";
+        return -1;
+    }
+    d = 2 * n - 1;
+    if (dlx_problem_init(p, 2 * n + 2 * d, 2 * n, 4 * n * n) < 0)
+        return -1;
+
+    for (i = 0; i < p->nitems; i++) {
+        if (i < (size_t) n)
+            sprintf(p->names[i], "r%d", (int) i);
+        else if (i < (size_t) 2 * n)
+            sprintf(p->names[i], "c%d", (int) i - n);
+        else if (i < (size_t) 2 * n + d)
+            sprintf(p->names[i], "a%d", (int) i - 2 * n);
+        else
+            sprintf(p->names[i], "b%d", (int) i - 2 * n - d);
+    }
+
+    for (r = 0; r < n; r++) {
+        for (c = 0; c < n; c++) {
+            cols[0] = r;
+            cols[1] = n + c;
+            cols[2] = 2 * n + r + c;
+            cols[3] = 2 * n + d + r - c + n - 1;
+            if (dlx_problem_add_option(p, cols, 4) < 0) {
+                dlx_problem_free(p);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_GEN_PENTOMINOES
+ * Pieces are items F .. Z (Conway's names), cells items "yx" with each
+ * coordinate a base 36 digit.  Every piece goes in every distinct rotation
+ * and reflection at every place it fits, so each packing is found once for
+ * each symmetry of the box; dlx_gen_box_sym undoes that for dlx_count_sym.
+ * @{
+ */
+
+#define NPIECES 12
+#define NCELLS  5
+
+/** piece names, and the (y, x) digit pairs of each piece's cells */
+static const char piece_names[NPIECES + 1] = "FILNPTUVWXYZ";
+static const char *const piece_cells[NPIECES] = {
+    "0102101121", "0001020304", "0010203031", "0111202130",
+    "0001101120", "0001021121", "0002101112", "0010202122",
+    "0010112122", "0110111221", "0110112131", "0001112122"
+};
+
+/** the piece whose column the box symmetry is broken on */
+#define PIVOT_PIECE 9       /* X */
+
+/** @brief Sort the n ints at a by insertion; n is at most NCELLS */
+static void sort_cells(int a[], int n)
+{
+    int i, j, t;
+
+    for (i = 1; i < n; i++)
+        for (j = i; j > 0 && a[j - 1] > a[j]; j--) {
+            t = a[j];
+            a[j] = a[j - 1];
+            a[j - 1] = t;
+        }
+}
+
+/**
+ * @brief Orientation t (0 .. 7: t & 3 quarter turns, reflected if t & 4) of
+ * piece k, moved to touch the top and left edges.
+ */
+static void orient(int k, int t, int y[NCELLS], int x[NCELLS])
+{
+    int i, r, v, miny = 5, minx = 5;
+
+    for (i = 0; i < NCELLS; i++) {
+        y[i] = piece_cells[k][2 * i] - '0';
+        x[i] = piece_cells[k][2 * i + 1] - '0';
+        if (t & 4)
+            x[i] = -x[i];
+        for (r = 0; r < (t & 3); r++) {
+            v = y[i];
+            y[i] = x[i];
+            x[i] = -v;
+        }
+    }
+    for (i = 0; i < NCELLS; i++) {
+        miny = y[i] < miny ? y[i] : miny;
+        minx = x[i] < minx ? x[i] : minx;
+    }
+    for (i = 0; i < NCELLS; i++) {
+        y[i] -= miny;
+        x[i] -= minx;
+    }
+}
+
+/** @return base 36 digit for v */
+static char digit36(int v)
+{
+    return v < 10 ? '0' + v : 'a' + v - 10;
+}
+
+/**
+ * @brief The pentominoes in a width x height box, which must have 60 cells.
+ * @return 0, or -1 if the box is the wrong size or out of memory
+ */
+int dlx_gen_pentominoes(dlx_problem *p, int width, int height)
+{
+    int y[NCELLS], x[NCELLS], cols[1 + NCELLS];
+    int seen[8][NCELLS];
+    int k, t, u, i, dy, dx, nseen, fits;
+
+    if (width < 1 || height < 1 || width > 36 || height > 36
+            || width * height != NPIECES * NCELLS) {
+        p->error = "bad size";
+        return -1;
+    }
+    if (dlx_problem_init(p, NPIECES + width * height, NPIECES + width * height,
+                         0) < 0)
+        return -1;
+    for (k = 0; k < NPIECES; k++)
+        p->names[k][0] = piece_names[k];
+    for (i = 0; i < width * height; i++) {
+        p->names[NPIECES + i][0] = digit36(i / width);
+        p->names[NPIECES + i][1] = digit36(i % width);
+    }
+
+    for (k = 0; k < NPIECES; k++) {
+        nseen = 0;
+        for (t = 0; t < 8; t++) {
+            /* skip orientations that look like one already placed */
+            orient(k, t, y, x);
+            for (i = 0; i < NCELLS; i++)
+                cols[1 + i] = y[i] * 8 + x[i];
+            sort_cells(cols + 1, NCELLS);
+            for (u = 0; u < nseen; u++)
+                if (memcmp(seen[u], cols + 1, sizeof(seen[u])) == 0)
+                    break;
+            if (u < nseen)
+                continue;
+            memcpy(seen[nseen++], cols + 1, sizeof(seen[0]));
+
+            for (dy = 0; dy < height; dy++) {
+                for (dx = 0; dx < width; dx++) {
+                    cols[0] = k;
+                    fits = 1;
+                    for (i = 0; i < NCELLS; i++) {
+                        if (y[i] + dy >= height || x[i] + dx >= width)
+                            fits = 0;
+                        cols[1 + i] = NPIECES + (y[i] + dy) * width + x[i]
+                                      + dx;
+                    }
+                    if (!fits)
+                        continue;
+                    sort_cells(cols + 1, NCELLS);
+                    if (dlx_problem_add_option(p, cols, 1 + NCELLS) < 0) {
+                        dlx_problem_free(p);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief dlx_sym hook for a box: a placement stands for its orbit under the
+ * box's reflections if no reflection of it has a smaller sorted cell list.
+ */
+static unsigned long box_orbit(const node *row, void *arg)
+{
+    const dlx_box *box = arg;
+    const node *j = row;
+    int cells[NCELLS], image[NCELLS];
+    int n = 0, i, g, y, x, stab = 0;
+    size_t k;
+
+    do {
+        k = dlx_item_index(box->p, j->chead);
+        if (k >= NPIECES && n < NCELLS)
+            cells[n++] = k - NPIECES;
+    } while ((j = j->right) != row);
+    sort_cells(cells, n);
+
+    /* the group of a box that is not square: both reflections, and both
+     * together (a half turn) */
+    for (g = 0; g < 4; g++) {
+        for (i = 0; i < n; i++) {
+            y = cells[i] / box->width;
+            x = cells[i] % box->width;
+            if (g & 1)
+                x = box->width - 1 - x;
+            if (g & 2)
+                y = box->height - 1 - y;
+            image[i] = y * box->width + x;
+        }
+        sort_cells(image, n);
+        for (i = 0; i < n && image[i] == cells[i]; i++)
+            ;
+        if (i < n && image[i] < cells[i])
+            return 0;       /* another placement stands for this orbit */
+        if (i == n)
+            stab++;
+    }
+    return 4 / stab;
+}
+
+/**
+ * @brief Set sym up to count the packings of p, made by
+ * dlx_gen_pentominoes(p, width, height), up to the symmetries of the box,
+ * branching on the X pentomino.  box holds what the hook needs, and must
+ * last as long as sym is used.
+ */
+void dlx_gen_box_sym(dlx_sym *sym, dlx_box *box, const dlx_problem *p,
+                     int width, int height)
+{
+    box->p      = p;
+    box->width  = width;
+    box->height = height;
+    sym->column = p->items + PIVOT_PIECE;
+    sym->orbit  = box_orbit;
+    sym->arg    = box;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_GEN_LANGFORD
+ * @{
+ */
+
+/**
+ * @brief Langford pairs for 1 .. n: items 1 .. n for the numbers and s0 ..
+ * for the 2n slots; option (k, j) puts the k's in slots j and j + k + 1.
+ * There are solutions only if n % 4 is 0 or 3, and each comes with its
+ * mirror image.
+ * @return 0, or -1 if n is out of range or out of memory
+ */
+int dlx_gen_langford(dlx_problem *p, int n)
+{
+    int k, j, cols[3];
+    size_t i;
+
+    if (n < 1 || n > 9999) {
+        p->error = "bad size";
+        return -1;
+    }
+    if (dlx_problem_init(p, 3 * n, 3 * n, 0) < 0)
+        return -1;
+    for (i = 0; i < p->nitems; i++) {
+        if (i < (size_t) n)
+            sprintf(p->names[i], "%d", (int) i + 1);
+        else
+            sprintf(p->names[i], "s%d", (int) i - n);
+    }
+
+    for (k = 1; k <= n; k++) {
+        for (j = 0; j + k + 1 < 2 * n; j++) {
+            cols[0] = k - 1;
+            cols[1] = n + j;
+            cols[2] = n + j + k + 1;
+            if (dlx_problem_add_option(p, cols, 3) < 0) {
+                dlx_problem_free(p);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/** @} */
+
+/**
+ * @name GROUP_DLX_GEN_RANDOM
+ * @{
+ */
+
+/** @brief Step the 32-bit xorshift generator at *x, which must not be 0 */
+static unsigned long next_random(unsigned long *x)
+{
+    unsigned long v = *x;
+
+    v ^= (v << 13) & 0xffffffffUL;
+    v ^= v >> 17;
+    v ^= (v << 5) & 0xffffffffUL;
+    return *x = v;
+}
+
+/** @brief qsort comparison for ints */
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+/**
+ * @brief Random options over items i0 .. i(nitems - 1), all primary.
+ *
+ * A random partition of the items into options of about density * nitems
+ * items each is hidden among the others, so that there is at least one
+ * solution; every other option has each item with probability density (and
+ * at least one item).  The options come in random order, and the same seed
+ * always makes the same problem.
+ *
+ * @param noptions  number of options, hidden ones included; if the hidden
+ *                  solution needs more, there are that many instead
+ * @return 0, or -1 if a parameter is out of range or out of memory
+ */
+int dlx_gen_random(dlx_problem *p, int nitems, int noptions, double density,
+                   unsigned long seed)
+{
+    unsigned long rng = seed & 0xffffffffUL;
+    unsigned long threshold;
+    int     *perm, *ends, *planted, *cols;
+    int     i, j, o, t, nplanted, size, span;
+
+    if (nitems < 1 || nitems > 99999 || noptions < 0
+            || !(density > 0 && density <= 1)) {
+        p->error = "bad size";
+        return -1;
+    }
+    if (rng == 0)
+        rng = 0x9e3779b9UL;
+    threshold = (unsigned long) (density * 0xffffffffUL);
+
+    perm    = malloc(nitems * sizeof(*perm));
+    ends    = malloc(nitems * sizeof(*ends));
+    planted = malloc((nitems + noptions) * sizeof(*planted));
+    cols    = malloc(nitems * sizeof(*cols));
+    if (perm == NULL || ends == NULL || planted == NULL || cols == NULL
+            || dlx_problem_init(p, nitems, nitems, 0) < 0) {
+        free(perm);
+        free(ends);
+        free(planted);
+        free(cols);
+        p->error = "out of memory";
+        return -1;
+    }
+    for (i = 0; i < nitems; i++)
+        sprintf(p->names[i], "i%d", i);
+
+    /* the hidden solution: a shuffle of the items cut into pieces */
+    for (i = 0; i < nitems; i++) {
+        j = next_random(&rng) % (i + 1);
+        perm[i] = perm[j];
+        perm[j] = i;
+    }
+    /* piece sizes 1 .. span average density * nitems */
+    if ((span = (int) (2 * density * nitems) - 1) < 1)
+        span = 1;
+    for (i = nplanted = 0; i < nitems; i = ends[nplanted++]) {
+        size = 1 + next_random(&rng) % span;
+        ends[nplanted] = i + size < nitems ? i + size : nitems;
+    }
+    if (noptions < nplanted)
+        noptions = nplanted;
+
+    /* planted[o] is the piece option o is, or -1 for a random option */
+    for (o = 0; o < noptions; o++) {
+        planted[o] = o < nplanted ? o : -1;
+        j = next_random(&rng) % (o + 1);
+        t = planted[o];
+        planted[o] = planted[j];
+        planted[j] = t;
+    }
+
+    for (o = 0; o < noptions; o++) {
+        if ((t = planted[o]) >= 0) {
+            size = ends[t] - (t > 0 ? ends[t - 1] : 0);
+            memcpy(cols, perm + ends[t] - size, size * sizeof(*cols));
+            qsort(cols, size, sizeof(*cols), cmp_int);
+        } else {
+            size = 0;
+            for (i = 0; i < nitems; i++)
+                if (next_random(&rng) <= threshold)
+                    cols[size++] = i;
+            if (size == 0)
+                cols[size++] = next_random(&rng) % nitems;
+        }
+        if (dlx_problem_add_option(p, cols, size) < 0) {
+            dlx_problem_free(p);
+            break;
+        }
+    }
+
+    free(perm);
+    free(ends);
+    free(planted);
+    free(cols);
+    return o < noptions ? -1 : 0;
+}
+
+/** @} */
@@ -94,3 +94,68 @@ hnode *make_sparse(const int *matrix, size_t rows, size_t columns)
     return h;
 }
 
+
+/**
+ * @brief Move the nodes of a matrix made by make_sparse, which mallocs them
+ * one by one, into a single block in traversal order (see dlx_compact).
+ * Nothing may be covered.  The matrix must then be freed with free_compact,
+ * given the block, instead of free_sparse.
+ * @return the block, or NULL if out of memory (h is left as it was)
+ */
+node *compact_sparse(hnode *h, size_t columns)
+{
+    dlx_layout l;
+    node **old;
+    node *arena, *c, *i;
+    size_t j, n = 0;
+
+    dlx_layout_stats(h, &l);
+    old   = malloc((l.nodes + 1) * sizeof(*old));
+    arena = malloc((l.nodes + 1) * sizeof(*arena));
+    if (old == NULL || arena == NULL) {
+        free(old);
+        free(arena);
+        return NULL;
+    }
+    for (j = 1; j <= columns; j++) {
+        c = (node *) (h + j);
+        for (i = c->down; i != c; i = i->down)
+            old[n++] = i;
+    }
+    dlx_compact(h, arena);
+    while (n > 0)
+        free(old[--n]);
+    free(old);
+    return arena;
+}
+
+/**
+ * @brief Free a matrix made by make_sparse whose nodes compact_sparse moved
+ * into arena.
+ */
+void free_compact(hnode *h, node *arena)
+{
+    free(arena);
+    free((void *) h[1].id);     /* the ids array, see make_sparse */
+    free(h);
+}
+
+/**
+ * @brief Free a matrix made by make_sparse.  Every row must be back in its
+ * columns, i.e. no search or dlx_force_row may be left half done.
+ */
+void free_sparse(hnode *h, size_t columns)
+{
+    size_t j;
+    node *c, *i, *next;
+
+    for (j = 1; j <= columns; j++) {
+        c = (node *) (h + j);
+        for (i = c->down; i != c; i = next) {
+            next = i->down;
+            free(i);
+        }
+    }
+    free_compact(h, NULL);
+}
+
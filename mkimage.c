@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Build-time generator of sudoku_image.h, the pristine 9x9 sudoku
+ * matrix that init() in sudoku.c copies instead of linking it up.
+ *
+ * Linked with a copy of sudoku.c compiled with -D SUDOKU_NO_IMAGE, which
+ * still builds the matrix the slow way, it builds one sudoku_dlx and prints
+ * it in index form: for the root, each column header and each node, in
+ * that order, its left, right, up, down and chead links as offsets from the
+ * start of the sudoku_dlx in units of pointers, plus each column's size.
+ *
+ * The offsets depend on how the compiler lays out a sudoku_dlx, so the
+ * image must come from the same compiler and flags as the code that uses
+ * it; sudoku.c refuses to compile against an image made for a sudoku_dlx
+ * of a different size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sudoku.h"
+
+/** the matrix to dump, too big for the stack */
+static sudoku_dlx image;
+
+/** @return the offset of p in image, in pointers; 0 for NULL */
+static unsigned long word(const void *p)
+{
+    unsigned long off;
+
+    if (p == NULL)
+        return 0;
+    off = (const char *) p - (const char *) &image;
+    if (off % sizeof(void *) != 0 || off / sizeof(void *) > 0xffff) {
+        fprintf(stderr, "mkimage: link at byte %lu does not fit\n", off);
+        exit(EXIT_FAILURE);
+    }
+    return off / sizeof(void *);
+}
+
+/** @brief Print the links of slot x, as one initializer */
+static void print_slot(const node *x, int last)
+{
+    printf("{%lu,%lu,%lu,%lu,%lu}%s", word(x->left), word(x->right),
+           word(x->up), word(x->down), word(x->chead), last ? "" : ",");
+}
+
+int main(void)
+{
+    const node *x;
+    size_t i, nslots = 1 + NCOLS + NROWS * NTYPES;
+
+    sudoku_dlx_init(&image);
+
+    printf("/* sudoku_image.h: made by mkimage, do not edit */\n\n");
+    printf("#define SUDOKU_IMAGE_BYTES  %lu\n",
+           (unsigned long) sizeof(image));
+    printf("#define SUDOKU_IMAGE_SLOTS  %lu\n\n", (unsigned long) nslots);
+
+    printf("/** root, headers and nodes: left, right, up, down, chead */\n");
+    printf("static const unsigned short sudoku_image[SUDOKU_IMAGE_SLOTS][5]"
+           " = {\n");
+    for (i = 0; i < nslots; i++) {
+        if (i == 0)
+            x = (const node *) &image.root;
+        else if (i <= NCOLS)
+            x = (const node *) (image.headers + i - 1);
+        else
+            x = image.nodes[0] + i - 1 - NCOLS;
+        print_slot(x, i == nslots - 1);
+        putchar(i % 4 == 3 || i == nslots - 1 ? '\n' : ' ');
+    }
+    printf("};\n\n");
+
+    printf("/** size of each column */\n");
+    printf("static const unsigned char sudoku_image_s[NCOLS] = {\n");
+    for (i = 0; i < NCOLS; i++)
+        printf("%lu%s", (unsigned long) image.headers[i].s,
+               i == NCOLS - 1 ? "\n" : i % 20 == 19 ? ",\n" : ",");
+    printf("};\n");
+
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -59,6 +59,12 @@ void draw_cell(NcSudokuGrid *ncboard, int r, int c)
     else
         wattroff(win, A_STANDOUT);
 
+    /* underline values that collide with another in a row, column or box */
+    if (is_cell_conflict(ncboard->board, r, c))
+        wattron(win, A_UNDERLINE);
+    else
+        wattroff(win, A_UNDERLINE);
+
     /* display fixed cells (givens) in bold */
     if (is_cell_fixed(ncboard->board, r, c))
         wattron(win, A_BOLD);
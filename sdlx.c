@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include "dlx.h"
+#include "dlx_file.h"
+#include "matrix.h"
+#include "dlx_gen.h"
+
+/** @brief what to do with the problem, see usage */
+typedef enum {
+    MODE_FIRST,
+    MODE_ALL,
+    MODE_COUNT,
+    MODE_ESTIMATE,
+    MODE_WRITE
+} mode;
+
+static const char *optstring = "vacLmsE:g:l:p:w:";
+
+static int      g_verbose_flag = 0;
+static mode     g_mode         = MODE_FIRST;
+static unsigned long g_probes  = 0;
+static unsigned long g_budget  = 0;
+static size_t   g_threads      = 1;
+static const char *g_write     = NULL;
+static const char *g_generator = NULL;
+static int      g_sym_flag     = 0;
+static int      g_sparse_flag  = 0;
+static int      g_layout_flag  = 0;
+static int      g_box_width    = 0;    /* set if the problem is a box */
+static int      g_box_height   = 0;
+
+static void usage(int argc, char *argv[])
+{
+    fprintf(stdout,
+
+"USAGE: %s [-p threads] [-l nodes] [-v] [file | -g generator]\n"
+"       %s {-a | -c [-s] | -E probes} [-L] [-m] [-p threads] [-l nodes]\n"
+"\t\t[-v] [file | -g generator]\n"
+"       %s -w {text | binary} [file | -g generator]\n\n"
+
+            , argv[0], argv[0], argv[0]);
+    fputs(
+
+"OPTIONS\n"
+"  -a\t\tprint every solution, each followed by a blank line\n"
+"  -c\t\tcount the solutions.  With -p, split the count between the\n"
+"\t\tthreads\n"
+"  -E probes\testimate the number of solutions, and the search nodes\n"
+"\t\tneeded to count them, from this many random probes\n"
+"  -g generator\tsolve a generated problem instead of a file: queens:n,\n"
+"\t\tpentominoes:wxh (a box of 60 cells), langford:n, or\n"
+"\t\trandom:items:options:density:seed (see matrix/dlx_gen.c)\n"
+
+            , stdout);
+    fputs(
+
+"  -L\t\tlay the nodes out in the order a search walks them\n"
+"\t\t(dlx_compact) before solving\n"
+"  -m\t\twith -c or -E and no -p, search a copy of the problem made\n"
+"\t\tby make_sparse, which mallocs each node on its own, instead\n"
+"\t\tof the problem itself\n"
+
+            , stdout);
+    fputs(
+
+"  -l nodes\tgive up after this many search nodes (per thread) and\n"
+"\t\texit with status 3.  Not with -a\n"
+"  -p threads\tsearch with this many threads, each on its own copy of\n"
+"\t\tthe problem.  Without -c, they race with different seeds to\n"
+"\t\tfind the first solution.  Not with -a, -E or -s\n"
+
+            , stdout);
+    fputs(
+
+"  -s\t\twith -c and pentominoes, count one packing of each orbit\n"
+"\t\tunder the symmetries of the box, and multiply\n"
+"  -v\t\tprint search nodes, solutions, time and an estimate of\n"
+"\t\tcache misses (see dlx_layout_stats) to stderr\n"
+"  -w format\tdo not solve; write the problem to standard output in\n"
+"\t\tKnuth's dlx1 text format, or in the compact binary format\n"
+"\t\t(see matrix/dlx_file.c)\n"
+
+            , stdout);
+    fputs(
+
+"\nInput\n"
+"\t\tAn exact cover problem in either format, read from file, or\n"
+"\t\tfrom standard input if there is none.  The first solution is\n"
+"\t\tprinted one option per line, as the items it covers, and the\n"
+"\t\texit status is 1 if there is no solution.\n"
+
+            , stdout);
+}
+
+/** @return seconds on a monotonic clock */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Print the k options of a solution, one per line, then a blank line.
+ * An option's nodes are consecutive in its arena block, so the one at the
+ * lowest address is its first item.
+ */
+static void print_solution(node *solution[], size_t k)
+{
+    size_t i;
+    node *j, *first;
+
+    for (i = 0; i < k; i++) {
+        first = j = solution[i];
+        while ((j = j->right) != solution[i])
+            if (j < first)
+                first = j;
+        j = first;
+        do {
+            fputs((const char *) j->chead->id, stdout);
+            putchar((j = j->right) != first ? ' ' : '\n');
+        } while (j != first);
+    }
+    putchar('\n');
+}
+
+/**
+ * @brief Make g_threads - 1 copies of p, for the threaded searches.
+ * @return array of g_threads roots, p's first, or NULL if out of memory
+ */
+static hnode **copy_problem(dlx_problem *p, dlx_problem **copies)
+{
+    hnode **roots;
+    size_t t;
+    int r;
+
+    roots   = malloc(g_threads * sizeof(*roots));
+    *copies = malloc(g_threads * sizeof(**copies));
+    if (roots == NULL || *copies == NULL) {
+        free(roots);
+        free(*copies);
+        return NULL;
+    }
+    roots[0] = &p->root;
+    for (t = 1; t < g_threads; t++) {
+        r = dlx_problem_copy(*copies + t, p);
+        if (r == 0 && g_layout_flag
+                && (r = dlx_problem_compact(*copies + t)) < 0)
+            dlx_problem_free(*copies + t);
+        if (r < 0) {
+            while (--t > 0)
+                dlx_problem_free(*copies + t);
+            free(roots);
+            free(*copies);
+            return NULL;
+        }
+        roots[t] = &(*copies)[t].root;
+    }
+    return roots;
+}
+
+/** @brief Free what copy_problem made */
+static void free_copies(hnode **roots, dlx_problem *copies)
+{
+    size_t t;
+
+    for (t = 1; t < g_threads; t++)
+        dlx_problem_free(copies + t);
+    free(copies);
+    free(roots);
+}
+
+/**
+ * @brief Copy p, which must have no secondary items, with make_sparse.
+ * @return the copy's root, or NULL if out of memory
+ */
+static hnode *sparse_copy(const dlx_problem *p)
+{
+    hnode   *h;
+    node    *j;
+    int     *matrix;
+    size_t  o;
+
+    if ((matrix = calloc(p->noptions * p->nitems + 1, sizeof(*matrix)))
+            == NULL)
+        return NULL;
+    for (o = 0; o < p->noptions; o++) {
+        j = p->options[o];
+        do {
+            matrix[o * p->nitems + dlx_item_index(p, j->chead)] = 1;
+        } while ((j = j->right) != p->options[o]);
+    }
+    h = make_sparse(matrix, p->noptions, p->nitems);
+    free(matrix);
+    return h;
+}
+
+/** @brief Free the copy of p that sparse_copy made, if root is one */
+static void free_root(const dlx_problem *p, hnode *root, node *arena)
+{
+    if (arena != NULL)
+        free_compact(root, arena);
+    else if (root != &p->root)
+        free_sparse(root, p->nitems);
+}
+
+/**
+ * @brief Solve p as g_mode says, printing the results to stdout, and
+ * statistics to stderr with -v.
+ * @return number of solutions found (0 or 1 for the first solution), or
+ *          DLX_EXHAUSTED, or DLX_EXHAUSTED - 1 if out of memory
+ */
+static size_t solve(dlx_problem *p)
+{
+    dlx_problem *copies = NULL;
+    hnode   **roots = NULL;
+    hnode   *root = &p->root;
+    node    *arena = NULL;  /* root's nodes, if compact_sparse moved them */
+    node    **solution;
+    dlx_ctl ctl;
+    dlx_est est;
+    dlx_iter it;
+    dlx_sym sym;
+    dlx_box box;
+    dlx_layout before, after;
+    double  start;
+    size_t  n = 0, winner = 0;
+
+    /* a solution uses each primary item once, so has at most that many */
+    if ((solution = malloc((p->nprimary + 1) * sizeof(*solution))) == NULL)
+        return DLX_EXHAUSTED - 1;
+    if (g_sparse_flag && (root = sparse_copy(p)) == NULL) {
+        free(solution);
+        return DLX_EXHAUSTED - 1;
+    }
+    if (g_verbose_flag)
+        dlx_layout_stats(root, &before);
+    if (g_layout_flag && (root != &p->root
+                ? (arena = compact_sparse(root, p->nitems)) == NULL
+                : dlx_problem_compact(p) < 0))
+        n = DLX_EXHAUSTED - 1;
+    else if (g_threads > 1 && (g_mode == MODE_FIRST || g_mode == MODE_COUNT)
+            && (roots = copy_problem(p, &copies)) == NULL)
+        n = DLX_EXHAUSTED - 1;
+    if (n == DLX_EXHAUSTED - 1) {
+        free_root(p, root, arena);
+        free(solution);
+        return n;
+    }
+    if (g_verbose_flag)
+        dlx_layout_stats(root, &after);
+    dlx_ctl_init(&ctl);
+    ctl.budget = g_budget;
+    start = now();
+
+    switch (g_mode) {
+        case MODE_FIRST:
+            if (roots != NULL)
+                n = dlx_portfolio(solution, p->nprimary, roots, g_threads,
+                                  &ctl, &winner);
+            else
+                n = dlx_exact_cover_ctl(solution, &p->root, &ctl);
+            if (n != DLX_EXHAUSTED && n > 0) {
+                print_solution(solution, n);
+                n = 1;
+            }
+            break;
+        case MODE_ALL:
+            dlx_iter_init(&it, &p->root, solution, p->nprimary);
+            while (dlx_iter_next(&it)) {
+                print_solution(solution, it.k);
+                n++;
+            }
+            break;
+        case MODE_COUNT:
+            if (g_sym_flag) {
+                dlx_gen_box_sym(&sym, &box, p, g_box_width, g_box_height);
+                n = dlx_count_sym(&p->root, &sym, &ctl);
+            } else if (roots != NULL) {
+                n = dlx_count_parallel(roots, g_threads, &ctl);
+            } else {
+                n = dlx_has_covers_ctl(root, DLX_EXHAUSTED - 1, &ctl);
+                if (n != DLX_EXHAUSTED)
+                    n = DLX_EXHAUSTED - 1 - n;
+            }
+            if (n != DLX_EXHAUSTED)
+                printf("%lu\n", (unsigned long) n);
+            break;
+        case MODE_ESTIMATE:
+            dlx_estimate(root, g_probes, &ctl, &est);
+            printf("solutions %.4g +- %.2g\n", est.solutions,
+                   est.solutions_ci);
+            printf("nodes %.4g +- %.2g\n", est.nodes, est.nodes_ci);
+            printf("probes %lu\n", est.probes);
+            break;
+        case MODE_WRITE:
+            break;
+    }
+
+    if (g_verbose_flag) {
+        fprintf(stderr, "%lu items (%lu primary), %lu options, %lu nodes\n",
+                (unsigned long) p->nitems, (unsigned long) p->nprimary,
+                (unsigned long) p->noptions, (unsigned long) p->nnodes);
+        fprintf(stderr, "%lu cache misses in %lu reads covering each item "
+                "once", (unsigned long) after.misses,
+                (unsigned long) after.reads);
+        if (g_layout_flag)
+            fprintf(stderr, " (%lu as read)", (unsigned long) before.misses);
+        putc('\n', stderr);
+        if (n == DLX_EXHAUSTED)
+            fprintf(stderr, "search budget exhausted\n");
+        else if (g_mode != MODE_ESTIMATE)
+            fprintf(stderr, "%lu solutions\n", (unsigned long) n);
+        if (g_mode != MODE_ALL)
+            fprintf(stderr, "%lu search nodes, %lu restarts\n",
+                    ctl.nodes, ctl.restarts);
+        if (roots != NULL && g_mode == MODE_FIRST && n != DLX_EXHAUSTED)
+            fprintf(stderr, "thread %lu answered first\n",
+                    (unsigned long) winner);
+        fprintf(stderr, "%.3f s\n", now() - start);
+    }
+
+    if (roots != NULL)
+        free_copies(roots, copies);
+    free_root(p, root, arena);
+    free(solution);
+    return n;
+}
+
+/**
+ * @brief Build the problem g_generator describes.
+ * @return 0, or -1 with p->error set
+ */
+static int generate(dlx_problem *p)
+{
+    const char *spec = g_generator;
+    unsigned long seed;
+    double  density;
+    int     a, b;
+
+    if (sscanf(spec, "queens:%d", &a) == 1)
+        return dlx_gen_queens(p, a);
+    if (sscanf(spec, "langford:%d", &a) == 1)
+        return dlx_gen_langford(p, a);
+    if (sscanf(spec, "pentominoes:%dx%d", &a, &b) == 2) {
+        g_box_width  = a;
+        g_box_height = b;
+        return dlx_gen_pentominoes(p, a, b);
+    }
+    if (sscanf(spec, "random:%d:%d:%lf:%lu", &a, &b, &density, &seed) == 4)
+        return dlx_gen_random(p, a, b, density, seed);
+    p->error = "unknown generator";
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    dlx_problem p;
+    const char *path = "-";
+    FILE    *f = stdin;
+    size_t  n;
+    int     opt, r;
+
+    while ((opt = getopt(argc, argv, optstring)) != -1) {
+        switch (opt) {
+            case 'v':
+                g_verbose_flag = 1;
+                break;
+            case 'a':
+                g_mode = MODE_ALL;
+                break;
+            case 'c':
+                g_mode = MODE_COUNT;
+                break;
+            case 'L':
+                g_layout_flag = 1;
+                break;
+            case 'm':
+                g_sparse_flag = 1;
+                break;
+            case 's':
+                g_sym_flag = 1;
+                break;
+            case 'g':
+                g_generator = optarg;
+                break;
+            case 'E':
+                g_mode = MODE_ESTIMATE;
+                g_probes = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                g_budget = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                if ((g_threads = strtoul(optarg, NULL, 10)) < 1)
+                    g_threads = 1;
+                break;
+            case 'w':
+                g_mode = MODE_WRITE;
+                g_write = optarg;
+                if (strcmp(g_write, "text") != 0
+                        && strcmp(g_write, "binary") != 0) {
+                    usage(argc, argv);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            default:
+                usage(argc, argv);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (g_generator != NULL) {
+        if (generate(&p) < 0) {
+            fprintf(stderr, "%s: %s\n", g_generator, p.error);
+            exit(EXIT_FAILURE);
+        }
+    } else if (optind < argc && strcmp(path = argv[optind], "-") != 0
+            && (f = fopen(path, "rb")) == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    } else if (dlx_read(&p, f) < 0) {
+        if (p.line > 0)
+            fprintf(stderr, "%s:%lu: %s\n", path, (unsigned long) p.line,
+                    p.error);
+        else
+            fprintf(stderr, "%s: %s\n", path, p.error);
+        exit(EXIT_FAILURE);
+    }
+    if (f != stdin)
+        fclose(f);
+
+    if (g_sparse_flag && ((g_mode != MODE_COUNT && g_mode != MODE_ESTIMATE)
+                || g_threads > 1 || g_sym_flag || p.nprimary < p.nitems)) {
+        fprintf(stderr, "%s: -m needs -c or -E, one thread, and no "
+                "secondary items\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (g_budget != 0 && g_mode == MODE_ALL) {
+        fprintf(stderr, "%s: -l does not work with -a\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (g_threads > 1 && (g_mode == MODE_ALL || g_mode == MODE_ESTIMATE)) {
+        fprintf(stderr, "%s: -p needs -c or a plain solve\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (g_sym_flag && (g_mode != MODE_COUNT || g_box_width == 0
+                || g_threads > 1)) {
+        fprintf(stderr, "%s: -s needs -c, one thread, and a -g "
+                "pentominoes box\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_mode == MODE_WRITE) {
+        if (strcmp(g_write, "text") == 0)
+            r = dlx_write_text(&p, stdout);
+        else
+            r = dlx_write_binary(&p, stdout);
+        if (r < 0 || fflush(stdout) != 0) {
+            perror(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        dlx_problem_free(&p);
+        exit(EXIT_SUCCESS);
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    n = solve(&p);
+    dlx_problem_free(&p);
+    if (n == DLX_EXHAUSTED - 1) {
+        perror(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (n == DLX_EXHAUSTED)
+        return 3;
+    return n > 0 || g_mode != MODE_FIRST ? EXIT_SUCCESS : 1;
+}
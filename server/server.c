@@ -0,0 +1,326 @@
+/**
+ * @file
+ * @brief Persistent solver daemon answering requests on a Unix domain socket.
+ *
+ * Each connection gets its own thread and its own sudoku_dlx, so the
+ * 324-column matrix is built once per context rather than once per puzzle;
+ * contexts are handed back to a small pool when a connection closes and
+ * reused by the next one.
+ *
+ * The protocol is line based.  A request is one line, answered by exactly one
+ * response line, in order:
+ *
+ *     S <puzzle>          solve                   OK <solution> | NO
+ *     C <n> <puzzle>      count up to n solutions OK <k> <solution> | NO
+ *     H <board>           next hint for board     OK <row> <col> <n> <choices>
+ *                                                 | NO
+ *
+ * where puzzle and board are 81 character puzzles as accepted by
+ * sudoku_solve, and a hint gives a 1-based row and column, the digit to
+ * enter and the number of choices DLX had for it.  A malformed request gets
+ * "ERR <reason>".  If the server was started with a search budget, a request
+ * whose search needs more nodes than that gets "ERR budget exhausted" rather
+ * than tying up its thread.  Clients may pipeline any number of requests:
+ * every complete line read is answered before the connection is read again,
+ * and the answers go out in a single write.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sudoku.h"
+#include "server.h"
+
+/** @brief State of one client connection. */
+typedef struct {
+    int         fd;
+    sudoku_dlx  *puzzle_dlx;
+    unsigned long budget;           /**< search nodes per request, 0 for any */
+    char        in[SERVER_BUFSIZE];
+    char        out[SERVER_BUFSIZE];
+    size_t      nin;                /**< bytes buffered in in */
+    size_t      nout;               /**< bytes buffered in out */
+    int         discard;            /**< skipping the rest of an overlong line */
+} connection;
+
+static pthread_mutex_t  pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static sudoku_dlx       *pool[SERVER_POOL];
+static size_t           npool = 0;
+
+/** @brief Take a solver context from the pool, or make a new one. */
+static sudoku_dlx *context_get(void)
+{
+    sudoku_dlx *puzzle_dlx = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if (npool > 0)
+        puzzle_dlx = pool[--npool];
+    pthread_mutex_unlock(&pool_lock);
+
+    if (puzzle_dlx == NULL && (puzzle_dlx = malloc(sizeof(*puzzle_dlx))))
+        sudoku_dlx_init(puzzle_dlx);
+    return puzzle_dlx;
+}
+
+/** @brief Hand a solver context back to the pool, or free it if full. */
+static void context_put(sudoku_dlx *puzzle_dlx)
+{
+    sudoku_clear_givens(puzzle_dlx);
+
+    pthread_mutex_lock(&pool_lock);
+    if (npool < SERVER_POOL) {
+        pool[npool++] = puzzle_dlx;
+        puzzle_dlx = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    free(puzzle_dlx);
+}
+
+/**
+ * @brief Write out everything buffered for the client.
+ * @return 0 on success, -1 if the client went away
+ */
+static int flush_out(connection *conn)
+{
+    size_t  off = 0;
+    ssize_t n;
+
+    while (off < conn->nout) {
+        n = send(conn->fd, conn->out + off, conn->nout - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        off += n;
+    }
+    conn->nout = 0;
+    return 0;
+}
+
+/**
+ * @brief Queue one response line; flushes first if it would not fit.
+ * @return 0 on success, -1 if the client went away
+ */
+static int reply(connection *conn, const char *line)
+{
+    size_t len = strlen(line);
+
+    if (conn->nout + len + 1 > sizeof(conn->out) && flush_out(conn) != 0)
+        return -1;
+    memcpy(conn->out + conn->nout, line, len);
+    conn->nout += len;
+    conn->out[conn->nout++] = '\n';
+    return 0;
+}
+
+/**
+ * @brief Answer one request line of len characters (newline excluded).
+ * @return 0 on success, -1 if the client went away
+ */
+static int handle_request(connection *conn, char *line, size_t len)
+{
+    sudoku_dlx  *puzzle_dlx = conn->puzzle_dlx;
+    sudoku_hint hints[81], *hint;
+    dlx_ctl     ctl, *limit = NULL;
+    char        solution[82];
+    char        resp[128];
+    char        *p;
+    unsigned long count = 0;
+    size_t      found;
+    int         r, c, n;
+
+    if (len > 0 && line[len - 1] == '\r')
+        len--;
+    line[len] = '\0';
+    if (len < 2 || line[1] != ' ')
+        return reply(conn, "ERR bad request");
+    p = line + 2;
+
+    switch (line[0]) {
+        case 'S':
+        case 'H':
+            break;
+        case 'C':
+            count = strtoul(p, &p, 10);
+            if (count == 0 || *p != ' ')
+                return reply(conn, "ERR bad count");
+            p++;
+            break;
+        default:
+            return reply(conn, "ERR unknown command");
+    }
+    if (strlen(p) < 81)
+        return reply(conn, "ERR short puzzle");
+    if (sudoku_load_givens(puzzle_dlx, p) < 0)
+        return reply(conn, "NO");
+    if (conn->budget != 0) {
+        dlx_ctl_init(&ctl);
+        ctl.budget = conn->budget;
+        limit = &ctl;
+    }
+
+    switch (line[0]) {
+        case 'S':
+            if ((r = sudoku_dlx_solve_ctl(puzzle_dlx, solution, limit)) < 0)
+                return reply(conn, "ERR budget exhausted");
+            if (r == 0)
+                return reply(conn, "NO");
+            sprintf(resp, "OK %s", solution);
+            break;
+        case 'C':
+            found = sudoku_dlx_nsolve_ctl(puzzle_dlx, solution, count, limit);
+            if (found == DLX_EXHAUSTED)
+                return reply(conn, "ERR budget exhausted");
+            if (found == 0)
+                return reply(conn, "NO");
+            sprintf(resp, "OK %lu %s", (unsigned long) found, solution);
+            break;
+        default:    /* 'H' */
+            /* the hint trace follows the same path as a plain solve, so a
+             * solve within budget means the trace is too */
+            if (limit != NULL
+                    && sudoku_dlx_solve_ctl(puzzle_dlx, solution, limit) < 0)
+                return reply(conn, "ERR budget exhausted");
+            if (!sudoku_dlx_solve_hints(puzzle_dlx, hints))
+                return reply(conn, "NO");
+            if ((hint = next_hint(hints, p)) == hints + 81)
+                return reply(conn, "NO");   /* board already full */
+            hint2rcn(hint, &r, &c, &n);
+            sprintf(resp, "OK %d %d %d %d", r, c, n, hint->nchoices);
+            break;
+    }
+    return reply(conn, resp);
+}
+
+/**
+ * @brief Answer every complete line in the input buffer, keeping any partial
+ * line for the next read.
+ * @return 0 on success, -1 if the client went away
+ */
+static int handle_input(connection *conn)
+{
+    char    *line = conn->in;
+    char    *end = conn->in + conn->nin;
+    char    *nl;
+
+    while ((nl = memchr(line, '\n', end - line)) != NULL) {
+        if (conn->discard)
+            conn->discard = 0;
+        else if (handle_request(conn, line, nl - line) != 0)
+            return -1;
+        line = nl + 1;
+    }
+
+    conn->nin = end - line;
+    if (conn->nin == sizeof(conn->in) - 1) {
+        /* no newline in a whole buffer: answer once, skip to next line */
+        conn->nin = 0;
+        if (!conn->discard && reply(conn, "ERR line too long") != 0)
+            return -1;
+        conn->discard = 1;
+    } else {
+        memmove(conn->in, line, conn->nin);
+    }
+    return 0;
+}
+
+/** @brief Thread body: serve one connection until the client hangs up. */
+static void *serve_connection(void *arg)
+{
+    connection  *conn = arg;
+    ssize_t     n;
+
+    for (;;) {
+        /* leave room for the terminator handle_request writes */
+        n = read(conn->fd, conn->in + conn->nin,
+                 sizeof(conn->in) - conn->nin - 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        conn->nin += n;
+        if (handle_input(conn) != 0 || flush_out(conn) != 0)
+            break;
+    }
+
+    close(conn->fd);
+    context_put(conn->puzzle_dlx);
+    free(conn);
+    return NULL;
+}
+
+/**
+ * @brief Listen on the Unix domain socket at path and serve clients until
+ * an error occurs.  A stale socket left at path is replaced.
+ * @param budget    search nodes allowed per request, 0 for no limit
+ * @return -1, with errno set; does not return on success
+ */
+int server_run(const char *path, int verbose, unsigned long budget)
+{
+    struct sockaddr_un  addr;
+    struct stat         st;
+    pthread_attr_t      attr;
+    pthread_t           thread;
+    connection          *conn;
+    int                 sock, fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return -1;
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0
+            || listen(sock, SOMAXCONN) != 0) {
+        close(sock);
+        return -1;
+    }
+    if (verbose)
+        fprintf(stderr, "listening on %s\n", path);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    for (;;) {
+        if ((fd = accept(sock, NULL, NULL)) < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        if ((conn = malloc(sizeof(*conn))) == NULL
+                || (conn->puzzle_dlx = context_get()) == NULL) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->budget = budget;
+        conn->nin = 0;
+        conn->nout = 0;
+        conn->discard = 0;
+        if (pthread_create(&thread, &attr, serve_connection, conn) != 0) {
+            context_put(conn->puzzle_dlx);
+            free(conn);
+            close(fd);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+    close(sock);
+    return -1;
+}
@@ -53,16 +53,28 @@
  *   - 81 rows in solution
  *
  * For how (r, c, n) maps back and forth to constraint column id's and row id's
- * see the get_ids / fill_values / hint2cells and row_id / hint2rcn /
- * to_simple_string functions
+ * see the get_ids / hint2cells and row2row_id / hint2rcn / to_simple_string
+ * functions
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include "sudoku.h"
 
+#ifndef SUDOKU_NO_IMAGE
+#include "sudoku_image.h"
+
+/* a compile error here means sudoku_image.h is out of date: make clean */
+typedef char sudoku_image_matches[
+    sizeof(sudoku_dlx) == SUDOKU_IMAGE_BYTES ? 1 : -1];
+#endif
+
+#ifdef SUDOKU_NO_IMAGE
+
 /**
  * @brief Fills col_ids with the NTYPES column ids satisfied by placing number
- * "n" at row r column c, in ascending order.
+ * "n" at row r column c, in ascending order.  Only the matrix builder uses
+ * it, so the image build leaves it out.
  */
 static void get_ids(int col_ids[], int r, int c, int n) 
 {
@@ -83,55 +95,50 @@ static void get_ids(int col_ids[], int r, int c, int n)
     col_ids[REGION_ID]  = REGION_ID * 81 + (9 * R) - 9 + n - 1;
 }
 
-/** @return row index given digit n in row r col c */
-static size_t row_id(int r, int c, int n)
-{
-    return ((9 * r) - 9 + c - 1) * 9 + n - 1;
-}
+#endif
 
 /**
- * @brief helper function to colid2rowid: computes as many of the parameters r,
- * c, n, R as it can given the input col id.  Reverse of function get_ids.
+ * @brief The cells of each row, column and region, in that order, for
+ * decoding row / column / region constraint ids without any arithmetic on
+ * r, c, R.  Cells are 0-indexed, in the order described in the file header.
+ * The other sudoku engines walk their units with it too.
  */
-static void fill_values(int col, int *r, int *c, int *n, int *R)
-{
-    if (col < (CELL_ID + 1) * 81) {
-        *r = (col - CELL_ID   * 81) / 9 + 1;
-        *c = (col - CELL_ID   * 81) % 9 + 1;
-    } else if (col < (ROW_ID + 1) * 81) {
-        *r = (col - ROW_ID    * 81) / 9 + 1;
-        *n = (col - ROW_ID    * 81) % 9 + 1;
-    } else if (col < (COL_ID + 1) * 81) {
-        *c = (col - COL_ID    * 81) / 9 + 1;
-        *n = (col - COL_ID    * 81) % 9 + 1;
-    } else { /* (col < (REGION_ID + 1) * 81) */
-        *R = (col - REGION_ID * 81) / 9 + 1;
-        *n = (col - REGION_ID * 81) % 9 + 1;
-    }
-}
+const unsigned char sudoku_unit_cells[27][9] = {
+    /* rows */
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8}, { 9, 10, 11, 12, 13, 14, 15, 16, 17},
+    {18, 19, 20, 21, 22, 23, 24, 25, 26}, {27, 28, 29, 30, 31, 32, 33, 34, 35},
+    {36, 37, 38, 39, 40, 41, 42, 43, 44}, {45, 46, 47, 48, 49, 50, 51, 52, 53},
+    {54, 55, 56, 57, 58, 59, 60, 61, 62}, {63, 64, 65, 66, 67, 68, 69, 70, 71},
+    {72, 73, 74, 75, 76, 77, 78, 79, 80},
+    /* columns */
+    { 0,  9, 18, 27, 36, 45, 54, 63, 72}, { 1, 10, 19, 28, 37, 46, 55, 64, 73},
+    { 2, 11, 20, 29, 38, 47, 56, 65, 74}, { 3, 12, 21, 30, 39, 48, 57, 66, 75},
+    { 4, 13, 22, 31, 40, 49, 58, 67, 76}, { 5, 14, 23, 32, 41, 50, 59, 68, 77},
+    { 6, 15, 24, 33, 42, 51, 60, 69, 78}, { 7, 16, 25, 34, 43, 52, 61, 70, 79},
+    { 8, 17, 26, 35, 44, 53, 62, 71, 80},
+    /* regions */
+    { 0,  1,  2,  9, 10, 11, 18, 19, 20}, { 3,  4,  5, 12, 13, 14, 21, 22, 23},
+    { 6,  7,  8, 15, 16, 17, 24, 25, 26}, {27, 28, 29, 36, 37, 38, 45, 46, 47},
+    {30, 31, 32, 39, 40, 41, 48, 49, 50}, {33, 34, 35, 42, 43, 44, 51, 52, 53},
+    {54, 55, 56, 63, 64, 65, 72, 73, 74}, {57, 58, 59, 66, 67, 68, 75, 76, 77},
+    {60, 61, 62, 69, 70, 71, 78, 79, 80}
+};
 
 /**
- * @brief Takes any 3 distinct column id's and computes the row index according
- * to the ordering described in init().
+ * @brief Computes the row index of the row containing node rn according to
+ * the ordering described in init().
+ *
+ * Since init() lays the rows out in nodes[][] in exactly that order, the
+ * index falls straight out of rn's position in the array; no column ids need
+ * to be decoded.
  *
  * @return row index according to ordering described in init().
  */
-static size_t row2row_id(node * rn)
+static size_t row2row_id(sudoku_dlx *puzzle_dlx, node *rn)
 {
-    int r, c, n, R;
-    r = c = n = R = 0;
-
-    fill_values(*(int *) (rn->chead->id), &r, &c, &n, &R);
-    rn = rn->right;
-    fill_values(*(int *) (rn->chead->id), &r, &c, &n, &R);
-    rn = rn->right;
-    fill_values(*(int *) (rn->chead->id), &r, &c, &n, &R);
-
-    /* with 3 values we are guaranteed to have r, c, and n */
-    return row_id(r, c, n);
+    return (rn - puzzle_dlx->nodes[0]) / NTYPES;
 }
 
-
 /**
  * @brief initializes the links in the preallocated nodes to a full sudoku dlx
  * array with 324 columns and 729 rows, corresponding to the entire search
@@ -142,6 +149,7 @@ static size_t row2row_id(node * rn)
  * file header comments.  Thus, the first row corresponds to 1 in (1,1), the
  * 2nd row is a 2 in (1,1), all the way up to the last row being a 9 in (9,9).
  */
+#ifdef SUDOKU_NO_IMAGE
 static void init(sudoku_dlx *puzzle_dlx)
 {
     int i, j, k;
@@ -175,56 +183,452 @@ static void init(sudoku_dlx *puzzle_dlx)
             }
 }
 
+#else
+
+/** @brief Set x's links from its entry w in the image, relative to base */
+static void relink(node *x, const unsigned short w[5], void **base)
+{
+    x->left  = (node *) (base + w[0]);
+    x->right = (node *) (base + w[1]);
+    x->up    = (node *) (base + w[2]);
+    x->down  = (node *) (base + w[3]);
+    x->chead = (hnode *) (base + w[4]);
+}
+
+/*
+ * The same matrix, copied from sudoku_image.h.  mkimage builds it at
+ * compile time with the code above, and stores each link as an offset from
+ * the start of the sudoku_dlx, so setting up a context is one pass over a
+ * 32 KB table in memory order, with none of the column appends.
+ */
+static void init(sudoku_dlx *puzzle_dlx)
+{
+    void **base = (void **) puzzle_dlx;
+    node *x;
+    size_t i;
+
+    x = (node *) &puzzle_dlx->root;
+    relink(x, sudoku_image[0], base);
+    x->up    = NULL;
+    x->down  = NULL;
+    x->chead = NULL;
+    puzzle_dlx->root.s  = 0;
+    puzzle_dlx->root.id = NULL;
+
+    for (i = 0; i < NCOLS; i++) {
+        relink((node *) (puzzle_dlx->headers + i), sudoku_image[1 + i], base);
+        puzzle_dlx->headers[i].s  = sudoku_image_s[i];
+        puzzle_dlx->headers[i].id = puzzle_dlx->ids + i;
+        puzzle_dlx->ids[i] = i;
+    }
+
+    x = puzzle_dlx->nodes[0];
+    for (i = 1 + NCOLS; i < SUDOKU_IMAGE_SLOTS; i++)
+        relink(x++, sudoku_image[i], base);
+}
+
+#endif
+
+/** @return cell index 0 - 80 of the row containing node rn */
+static int row2cell(sudoku_dlx *puzzle_dlx, node *rn)
+{
+    return row2row_id(puzzle_dlx, rn) / 9;
+}
+
 /**
- * @brief Remove givens from the full dlx matrix while making sure the puzzle
- * is still valid.
- *
- * @param solution  givens are added here in the order they are processed
- *
- * @return number of givens found, or some number > 81 if any givens conflict
- *         (which means puzzle is invalid and has no solution)
+ * @brief convert solution rows to 81 char string form.  Only the cells
+ * covered by the len rows are written, plus the null terminator.
  */
-static int
-process_givens(const char *givens, sudoku_dlx *puzzle_dlx, node *solution[])
+static void
+to_simple_string(char *buf, sudoku_dlx *puzzle_dlx, node *solution[], size_t len)
 {
     size_t n, i;
-    int c;
+    for (i = 0; i < len; i++) {
+        n = row2row_id(puzzle_dlx, solution[i]); /* see init() comments for row id order */
+        buf[n / 9] = n % 9 + '1';
+    }
+    buf[81] = '\0';
+}
+
+/**
+ * @name GROUP_SUDOKU_DEBUG_CHECKS
+ * With -D DLX_DEBUG, every change to the givens of a context is followed by
+ * dlx_verify, and every search is bracketed by a dlx_snapshot before and a
+ * dlx_verify against it after, so a corrupted context aborts at the call
+ * that broke it instead of giving wrong answers later.  Without DLX_DEBUG
+ * these do nothing.
+ * @{
+ */
+
+/** @brief a snapshot taken by search_begin, for search_end */
+typedef struct {
+    dlx_snap    *snap;
+    size_t      n;
+} search_check;
+
+#ifdef DLX_DEBUG
+static void context_corrupted(const char *where)
+{
+    fprintf(stderr, "sudoku: solver context corrupted after %s\n", where);
+    abort();
+}
+#endif
+
+/** @brief check the links of the context after its givens changed */
+static void check_context(sudoku_dlx *puzzle_dlx, const char *where)
+{
+#ifdef DLX_DEBUG
+    if (dlx_verify(&puzzle_dlx->root, NULL, 0) != 0)
+        context_corrupted(where);
+#else
+    (void) puzzle_dlx;
+    (void) where;
+#endif
+}
+
+/** @brief snapshot the context before a search */
+static void search_begin(sudoku_dlx *puzzle_dlx, search_check *chk)
+{
+    chk->snap = NULL;
+    chk->n = 0;
+#ifdef DLX_DEBUG
+    chk->n = dlx_snapshot(&puzzle_dlx->root, NULL, 0);
+    if ((chk->snap = malloc(sizeof(*chk->snap) * chk->n)) != NULL)
+        dlx_snapshot(&puzzle_dlx->root, chk->snap, chk->n);
+#else
+    (void) puzzle_dlx;
+#endif
+}
+
+/** @brief check that a search left the context as search_begin found it */
+static void search_end(sudoku_dlx *puzzle_dlx, search_check *chk,
+                       const char *where)
+{
+#ifdef DLX_DEBUG
+    if (chk->snap != NULL
+            && dlx_verify(&puzzle_dlx->root, chk->snap, chk->n) != 0)
+        context_corrupted(where);
+#else
+    (void) puzzle_dlx;
+    (void) where;
+#endif
+    free(chk->snap);
+}
+
+/** @} */
+
+/**
+ * @name GROUP_SUDOKU_DLX_CONTEXT
+ * A sudoku_dlx can be kept around as a persistent solver context: givens are
+ * added and removed one cell at a time with dlx_force_row / dlx_unselect_row,
+ * so an edit only touches the rows affected by it instead of redoing init().
+ * The forced rows are kept in the givens[] stack in selection order, which is
+ * the LIFO order dlx_unselect_row needs.  Cells are numbered 0 - 80 here, in
+ * the same order as the puzzle string (and the cell ids from hint2cells).
+ * @{
+ */
+
+/**
+ * @brief Undo the rows rows[from .. to - 1] forced by dlx_propagate, last
+ * first.  Searches run dlx_propagate on top of the givens first, so that the
+ * naked and hidden singles it finds cost no branching and no recursion level
+ * each.
+ */
+static void unpropagate(node *rows[], size_t from, size_t to)
+{
+    while (to > from)
+        dlx_unselect_row(rows[--to]);
+}
+
+/** @brief initialize puzzle_dlx to an empty puzzle with no givens */
+void sudoku_dlx_init(sudoku_dlx *puzzle_dlx)
+{
+    init(puzzle_dlx);
+    puzzle_dlx->ngivens = 0;
+}
+
+/**
+ * @brief Place given n in cell, replacing any given already in that cell.
+ *
+ * @return 0 on success, -1 if n conflicts with another given or either
+ *         argument is out of range; the givens are left unchanged on failure.
+ */
+int sudoku_set_given(sudoku_dlx *puzzle_dlx, int cell, int n)
+{
     node *ni;
-    /* eliminate givens one at a time: iterate through all 81 cells */
-    n = 0;      /* num givens found so far */
+    int old = 0;    /* digit previously in cell, if any */
+    size_t k;
+
+    if (cell < 0 || cell >= 81 || n < 1 || n > 9)
+        return -1;
+
+    /* A row in an already covered cell column is never removed from that
+     * column, so dlx_force_row cannot detect a second digit in the same cell;
+     * take the old one out first. */
+    for (k = 0; k < puzzle_dlx->ngivens; k++) {
+        if (row2cell(puzzle_dlx, puzzle_dlx->givens[k]) == cell) {
+            old = row2row_id(puzzle_dlx, puzzle_dlx->givens[k]) % 9 + 1;
+            if (old == n)
+                return 0;
+            sudoku_clear_given(puzzle_dlx, cell);
+            break;
+        }
+    }
+
+    /* given how row order from init matches cell order, the row index is
+     * simple to calculate; pick any node in the row (i.e. first one) */
+    ni = puzzle_dlx->nodes[cell * 9 + n - 1];
+    if (dlx_force_row(ni) != 0) {
+        /* ni has already been removed, meaning it conflicts with another
+         * given; put the old digit back, which cannot fail */
+        if (old)
+            sudoku_set_given(puzzle_dlx, cell, old);
+        return -1;
+    }
+    puzzle_dlx->givens[puzzle_dlx->ngivens++] = ni;
+    check_context(puzzle_dlx, "sudoku_set_given");
+    return 0;
+}
+
+/**
+ * @brief Remove the given in cell.
+ *
+ * Only the givens placed after it have to be unselected and forced again, so
+ * clearing the most recently set given is the cheapest.
+ *
+ * @return 0 on success, -1 if cell has no given
+ */
+int sudoku_clear_given(sudoku_dlx *puzzle_dlx, int cell)
+{
+    size_t k, i;
+    size_t n = puzzle_dlx->ngivens;
+    node **givens = puzzle_dlx->givens;
+
+    for (k = 0; k < n; k++)
+        if (row2cell(puzzle_dlx, givens[k]) == cell)
+            break;
+    if (k == n)
+        return -1;
+
+    /* unselect in reverse order down to and including the cleared given */
+    for (i = n; i > k; i--)
+        dlx_unselect_row(givens[i - 1]);
+
+    /* close the gap and force the later givens again; they were consistent
+     * with one more given, so none of them can fail now */
+    for (i = k; i < n - 1; i++) {
+        givens[i] = givens[i + 1];
+        dlx_force_row(givens[i]);
+    }
+    puzzle_dlx->ngivens = n - 1;
+    check_context(puzzle_dlx, "sudoku_clear_given");
+    return 0;
+}
+
+/** @brief Remove all givens, restoring the full search space. */
+void sudoku_clear_givens(sudoku_dlx *puzzle_dlx)
+{
+    while (puzzle_dlx->ngivens > 0)
+        dlx_unselect_row(puzzle_dlx->givens[--puzzle_dlx->ngivens]);
+    check_context(puzzle_dlx, "sudoku_clear_givens");
+}
+
+/**
+ * @brief Replace the givens with those in puzzle.
+ *
+ * @param puzzle    81 char string in the format described in sudoku_solve
+ * @return number of givens found, or -1 if any givens conflict (which means
+ *         puzzle is invalid and has no solution); no givens are left set
+ *         in that case.
+ */
+int sudoku_load_givens(sudoku_dlx *puzzle_dlx, const char *puzzle)
+{
+    int i, c;
+
+    sudoku_clear_givens(puzzle_dlx);
     for (i = 0; i < 81; i++) {
         /* could also just use isdigit, but w/e */
-        c = givens[i] - '0';
-        if (c > 0 && c <= 9) { /* c is a digit */
-            /* given how row order from init matches input cell order, row index
-             * is simple to calculate; pick any node in the row (i.e. first
-             * one), and force select it */
-            ni = puzzle_dlx->nodes[i * 9 + c - 1];
-            if (dlx_force_row(ni) != 0) {
-                /* non-zero return means ni has already been removed, meaning
-                 * it conflicts with a previously encountered given, so puzzle
-                 * is invalid; anything > 81 will do since you can only have
-                 * 81 givens */
-                n = 255;
-                break;
-            }
-            solution[n++] = ni;     /* add given row to solution, increment count */
+        c = puzzle[i] - '0';
+        if (c > 0 && c <= 9 && sudoku_set_given(puzzle_dlx, i, c) != 0) {
+            sudoku_clear_givens(puzzle_dlx);
+            return -1;
         }
     }
-    return n;
+    return puzzle_dlx->ngivens;
 }
 
-/** @brief convert solution rows to 81 char string form */
-static void to_simple_string(char *buf, node *solution[], size_t len)
+/**
+ * @brief Solves the puzzle made up of the current givens and puts the
+ * solution in buf, under the budget and stop flag in ctl (see
+ * dlx_exact_cover_ctl).  The givens are left in place.
+ *
+ * @param buf   char array, must be 82 characters long to hold
+ *              solution and null terminator byte.
+ * @param ctl   search controls, or NULL for the plain search with no limits
+ * @return 0 if unsolveable, 1 if solution found, -1 if the search ran out of
+ *          budget or was stopped
+ */
+int sudoku_dlx_solve_ctl(sudoku_dlx *puzzle_dlx, char *buf, dlx_ctl *ctl)
 {
-    size_t n, i;
-    for (i = 0; i < len; i++) {
-        n = row2row_id(solution[i]); /* see init() comments for row id order */
-        buf[n / 9] = n % 9 + '1';
+    node    *solution[81];
+    size_t  n, p, i, k = 0;
+    search_check chk;
+
+    n = puzzle_dlx->ngivens;
+    for (i = 0; i < n; i++)
+        solution[i] = puzzle_dlx->givens[i];
+
+    search_begin(puzzle_dlx, &chk);
+    p = n;
+    if (dlx_propagate(&puzzle_dlx->root, solution, &p, 81) == 0) {
+        if (ctl != NULL)
+            k = dlx_exact_cover_ctl(solution + p, &puzzle_dlx->root, ctl);
+        else
+            k = dlx_exact_cover(solution + p, &puzzle_dlx->root, 0);
+    }
+    unpropagate(solution, puzzle_dlx->ngivens, p);
+    search_end(puzzle_dlx, &chk, "sudoku_dlx_solve");
+
+    if (k == DLX_EXHAUSTED)
+        return -1;
+    n = p + k;
+    if (n < 81)     /* no solution found */
+        return 0;
+
+    to_simple_string(buf, puzzle_dlx, solution, n);
+
+    return 1;
+}
+
+/**
+ * @brief Solves the puzzle made up of the current givens and puts the
+ * solution in buf.  The givens are left in place.
+ *
+ * @param buf   char array, must be 82 characters long to hold
+ *              solution and null terminator byte.
+ * @return 0 if unsolveable, 1 if solution found.
+ */
+int sudoku_dlx_solve(sudoku_dlx *puzzle_dlx, char *buf)
+{
+    return sudoku_dlx_solve_ctl(puzzle_dlx, buf, NULL);
+}
+
+/**
+ * @brief Tries to find up to n solutions of the puzzle made up of the current
+ * givens, under the budget and stop flag in ctl (see dlx_has_covers_ctl).  The
+ * givens are left in place.
+ *
+ * @param buf   filled if not NULL, set to NULL to ignore
+ * @param ctl   search controls, or NULL for the plain search with no limits;
+ *              filling buf counts against the same budget
+ * @return 0 if unsolvable, else, number of solutions found, or DLX_EXHAUSTED
+ *          if the search ran out of budget or was stopped
+ */
+size_t sudoku_dlx_nsolve_ctl(sudoku_dlx *puzzle_dlx, char *buf, size_t n,
+                             dlx_ctl *ctl)
+{
+    node    *forced[81];
+    size_t  a = n, p = 0;
+    search_check chk;
+
+    search_begin(puzzle_dlx, &chk);
+    if (dlx_propagate(&puzzle_dlx->root, forced, &p, 81) == 0) {
+        if (ctl != NULL)
+            a = dlx_has_covers_ctl(&puzzle_dlx->root, n, ctl);
+        else
+            a = dlx_has_covers(&puzzle_dlx->root, n);
+    }
+    unpropagate(forced, 0, p);
+    search_end(puzzle_dlx, &chk, "sudoku_dlx_nsolve");
+
+    if (a == DLX_EXHAUSTED)
+        return DLX_EXHAUSTED;
+    if (a == n)     /* no solution */
+        return 0;
+
+    if (buf != NULL && sudoku_dlx_solve_ctl(puzzle_dlx, buf, ctl) < 0)
+        return DLX_EXHAUSTED;
+
+    return n - a;
+}
+
+/**
+ * @brief Estimate the number of solutions of the puzzle made up of the
+ * current givens, and the cost of counting them, with dlx_estimate.  The
+ * givens are left in place.
+ *
+ * @param ctl   seed and limits for dlx_estimate
+ */
+void sudoku_dlx_estimate(sudoku_dlx *puzzle_dlx, unsigned long probes,
+                         dlx_ctl *ctl, dlx_est *est)
+{
+    node    *forced[81];
+    size_t  p = 0;
+    search_check chk;
+
+    search_begin(puzzle_dlx, &chk);
+    if (dlx_propagate(&puzzle_dlx->root, forced, &p, 81) == 0) {
+        dlx_estimate(&puzzle_dlx->root, probes, ctl, est);
+    } else {
+        est->probes    = probes;
+        est->solutions = est->solutions_ci = 0;
+        est->nodes     = est->nodes_ci = 0;
+    }
+    unpropagate(forced, 0, p);
+    search_end(puzzle_dlx, &chk, "sudoku_dlx_estimate");
+}
+
+/**
+ * @brief Tries to find up to n solutions of the puzzle made up of the current
+ * givens.  The givens are left in place.
+ *
+ * @param buf   filled if not NULL, set to NULL to ignore
+ * @return 0 if unsolvable, else, number of solutions found
+ */
+size_t sudoku_dlx_nsolve(sudoku_dlx *puzzle_dlx, char *buf, size_t n)
+{
+    return sudoku_dlx_nsolve_ctl(puzzle_dlx, buf, n, NULL);
+}
+
+/**
+ * @brief Start enumerating every solution of the puzzle made up of the
+ * current givens.  The givens must not change until sudoku_iter_next returns
+ * 0 or sudoku_iter_abort is called.
+ */
+void sudoku_iter_init(sudoku_iter *si, sudoku_dlx *puzzle_dlx)
+{
+    si->puzzle_dlx = puzzle_dlx;
+    dlx_iter_init(&si->it, &puzzle_dlx->root, si->rows, 81);
+
+    /* the given cells are the same in every solution; fill them in once */
+    to_simple_string(si->buf, puzzle_dlx, puzzle_dlx->givens,
+                     puzzle_dlx->ngivens);
+}
+
+/**
+ * @brief Find the next solution.
+ * @return the solution as an 81 char string, valid until the next call, or
+ *          NULL if there are no more
+ */
+const char *sudoku_iter_next(sudoku_iter *si)
+{
+    if (!dlx_iter_next(&si->it)) {
+        check_context(si->puzzle_dlx, "sudoku_iter_next");
+        return NULL;
     }
-    buf[len] = '\0';
+    to_simple_string(si->buf, si->puzzle_dlx, si->rows, si->it.k);
+    return si->buf;
+}
+
+/** @brief Stop an enumeration early, leaving only the givens selected. */
+void sudoku_iter_abort(sudoku_iter *si)
+{
+    dlx_iter_abort(&si->it);
+    check_context(si->puzzle_dlx, "sudoku_iter_abort");
 }
 
+/** @} */
+
 /**
  * @brief solves puzzle and puts solution in buf
  * @param puzzle    81 char string representing puzzle.  Cells go in order left
@@ -237,22 +641,13 @@ static void to_simple_string(char *buf, node *solution[], size_t len)
 int sudoku_solve(const char *puzzle, char *buf)
 {
     sudoku_dlx  puzzle_dlx;
-    node        *solution[81];
-    size_t      n;
 
-    init(&puzzle_dlx);  /* make full sudoku dlx array */
+    sudoku_dlx_init(&puzzle_dlx);  /* make full sudoku dlx array */
 
-    if ((n = process_givens(puzzle, &puzzle_dlx, solution)) > 81)
+    if (sudoku_load_givens(&puzzle_dlx, puzzle) < 0)
         return 0;      /* invalid givens, no solution possible */
 
-    n += dlx_exact_cover(solution + n, &puzzle_dlx.root, 0);
-
-    if (n < 81)     /* no solution found */
-        return 0;
-
-    to_simple_string(buf, solution, n);
-
-    return 1;
+    return sudoku_dlx_solve(&puzzle_dlx, buf);
 }
 
 /**
@@ -264,24 +659,59 @@ int sudoku_solve(const char *puzzle, char *buf)
 size_t sudoku_nsolve(const char *puzzle, char *buf, size_t n)
 {
     sudoku_dlx  puzzle_dlx;
-    node        *solution[81];
-    size_t      s, a;
 
-    init(&puzzle_dlx);
-    if ((s = process_givens(puzzle, &puzzle_dlx, solution)) > 81)
+    sudoku_dlx_init(&puzzle_dlx);
+    if (sudoku_load_givens(&puzzle_dlx, puzzle) < 0)
         return 0;   /* invalid givens, no solution */
 
-    a = dlx_has_covers(&puzzle_dlx.root, n);
+    return sudoku_dlx_nsolve(&puzzle_dlx, buf, n);
+}
+
+/**
+ * @brief Solves the puzzle made up of the current givens, with solution
+ * hints.  The givens are left in place.
+ * @param hints     81 hints
+ * @return 0 if unsolveable, 1 if solution found.
+ */
+int sudoku_dlx_solve_hints(sudoku_dlx *puzzle_dlx, sudoku_hint hints[])
+{
+    dlx_hint    dlx_hints[81];
+    node        *forced[81];
+    node        **givens = puzzle_dlx->givens;
+    size_t      n, p = 0, m = 0, i;
+    search_check chk;
+
+    /* fill hints for the givens */
+    n = puzzle_dlx->ngivens;
+    for (i = 0; i < n; i++) {
+        hints[i].constraint_id = *((int *) givens[i]->chead->id);
+        hints[i].solution_id = row2row_id(puzzle_dlx, givens[i]);
+        hints[i].nchoices = 1;  /* it's a given; only 1 choice available */
+    }
 
-    s += dlx_exact_cover(solution + s, &puzzle_dlx.root, 0);
+    search_begin(puzzle_dlx, &chk);
+    if (dlx_propagate(&puzzle_dlx->root, forced, &p, 81 - n) == 0)
+        m = dlx_exact_cover_hints(dlx_hints, &puzzle_dlx->root, 0);
+    unpropagate(forced, 0, p);
+    search_end(puzzle_dlx, &chk, "sudoku_dlx_solve_hints");
 
-    if (s < 81)     /* no solution */
+    if (n + p + m < 81)     /* no solution found */
         return 0;
 
-    if (buf != NULL)
-        to_simple_string(buf, solution, s);
+    /* fill hints: singles found by propagation had only 1 choice, and
+     * forced[i]->chead is the constraint that left them no other */
+    for (i = 0; i < p; i++, n++) {
+        hints[n].constraint_id = *((int *) forced[i]->chead->id);
+        hints[n].solution_id = row2row_id(puzzle_dlx, forced[i]);
+        hints[n].nchoices = 1;
+    }
+    for (i = 0; i < m; i++, n++) {
+        hints[n].constraint_id = *((int *) dlx_hints[i].row->chead->id);
+        hints[n].solution_id = row2row_id(puzzle_dlx, dlx_hints[i].row);
+        hints[n].nchoices = dlx_hints[i].s;
+    }
 
-    return n - a;
+    return 1;
 }
 
 /**
@@ -296,35 +726,13 @@ size_t sudoku_nsolve(const char *puzzle, char *buf, size_t n)
 int sudoku_solve_hints(const char *puzzle, sudoku_hint hints[])
 {
     sudoku_dlx  puzzle_dlx;
-    node        *solution[81];
-    dlx_hint    dlx_hints[81];
-    size_t      n, i;
 
-    init(&puzzle_dlx);  /* make full sudoku dlx array */
+    sudoku_dlx_init(&puzzle_dlx);  /* make full sudoku dlx array */
 
-    if ((n = process_givens(puzzle, &puzzle_dlx, solution)) > 81)
+    if (sudoku_load_givens(&puzzle_dlx, puzzle) < 0)
         return 0;      /* invalid givens, no solution possible */
 
-    /* fill hints for the givens */
-    for (i = 0; i < n; i++) {
-        hints[i].constraint_id = *((int *) solution[i]->chead->id);
-        hints[i].solution_id = row2row_id(solution[i]);
-        hints[i].nchoices = 1;  /* it's a given; only 1 choice available */
-    }
-
-    n += dlx_exact_cover_hints(dlx_hints + n, &puzzle_dlx.root, 0);
-
-    if (n < 81)     /* no solution found */
-        return 0;
-
-    /* fill hints */
-    for (; i < 81; i++) {
-        hints[i].constraint_id = *((int *) dlx_hints[i].row->chead->id);
-        hints[i].solution_id = row2row_id(dlx_hints[i].row);
-        hints[i].nchoices = dlx_hints[i].s;
-    }
-
-    return 1;
+    return sudoku_dlx_solve_hints(&puzzle_dlx, hints);
 }
 
 /** @brief convert hint to row, col, number */
@@ -344,29 +752,21 @@ void hint2rcn(sudoku_hint *hint, int *r, int *c, int *n)
 size_t hint2cells(sudoku_hint *hint, int cell_ids[])
 {
     size_t i;
-    int r, c, n, R; 
     int constraint_id = hint->constraint_id;
-    r = c = n = R = 0;
+    const unsigned char *cells;
 
-    fill_values(constraint_id, &r, &c, &n, &R);
-    
-    i = 0;
+    /* cell constraint ids are numbered the same way as the cells */
     if (constraint_id < (CELL_ID + 1) * 81) {
-        cell_ids[0] = 9 * (r - 1) + c - 1;
-        ++i;
-    } else if (constraint_id < (ROW_ID + 1) * 81) {
-        for (i = 0; i < 9; i++) /* i = 0-indexed c */
-            cell_ids[i] = 9 * (r - 1) + i;
-    } else if (constraint_id < (COL_ID + 1) * 81) {
-        for (i = 0; i < 9; i++) /* i = 0-indexed r */
-            cell_ids[i] = 9 * (i) + c - 1;
-    } else { /* (constraint_id < (REGION_ID + 1) * 81) */
-        /* reverse formala for R from get_ids, but use 0-indexing */
-        r = (R - 1) / 3 * 3;    /* r = 0-indexed version of r */
-        c = (R - 1) % 3 * 3;    /* c = 0-indexed version of c */
-        for (i = 0; i < 9; i++)
-            cell_ids[i] = (r + i / 3) * 9 + c + i % 3;
+        cell_ids[0] = constraint_id - CELL_ID * 81;
+        return 1;
     }
+
+    /* the row, column and region constraints each come in groups of 9 (one
+     * per number) for every unit, and the units are in sudoku_unit_cells
+     * order */
+    cells = sudoku_unit_cells[(constraint_id - ROW_ID * 81) / 9];
+    for (i = 0; i < 9; i++)
+        cell_ids[i] = cells[i];
     return i;
 }
 
@@ -0,0 +1,245 @@
+/**
+ * @file
+ * @brief Batched sudoku solver: constraint propagation for SUDOKU_BATCH_LANES
+ * puzzles at once, one puzzle per SIMD lane.
+ *
+ * The boards of a batch are interleaved: for every cell there is one vector
+ * of candidate masks and one vector of placed digits, with lane l holding
+ * puzzle l.  Every step of the propagation is then the same sequence of ANDs,
+ * ORs and compares for all puzzles, so a whole batch costs about as much as a
+ * single board does:
+ *
+ *  - each row, column and region ORs its placed digits together and takes
+ *    them out of its cells' candidates;
+ *  - each unit finds its hidden singles (digits that are a candidate in only
+ *    one of its cells) and narrows those cells to that digit;
+ *  - every cell left with a single candidate gets it placed.
+ *
+ * until a round places nothing in any lane.  A lane in which some digit ends
+ * up placed twice in a unit, an empty cell runs out of candidates, or a unit
+ * has no place left for a digit has no solution.  Easy puzzles are solved by
+ * this alone, and a board solved by forced moves only has exactly one
+ * solution.  Lanes left with empty cells are handed, with everything
+ * propagation placed added to their givens, to the DLX solver.
+ *
+ * The vectors are GCC vector extensions, which the compiler maps onto
+ * whatever the target has.  On x86-64 Linux the propagation is built twice,
+ * for AVX2 (a cell's 16 lanes in one register) and for the SSE2 baseline
+ * (two registers), and the loader picks the one the CPU supports.  Other
+ * compilers solve the puzzles one at a time with DLX.
+ */
+
+#include <string.h>
+#include "sudoku.h"
+#include "sudoku_batch.h"
+
+#define ALL_DIGITS  0x1ff
+
+#ifdef __GNUC__
+
+#define HAVE_BATCH_VECTORS
+
+#if __GNUC__ >= 6 && defined(__x86_64__) && defined(__linux__)
+#define HAVE_BATCH_CLONES
+#define BATCH_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define BATCH_CLONES
+#endif
+
+/** one 16-bit mask per lane */
+typedef unsigned short lanes
+    __attribute__((vector_size(2 * SUDOKU_BATCH_LANES)));
+
+/** @brief SUDOKU_BATCH_LANES partly filled boards, interleaved. */
+typedef struct {
+    lanes   cand[81];   /**< candidates of empty cells, 0 in filled ones */
+    lanes   value[81];  /**< bit of the digit in filled cells, else 0 */
+    lanes   dead;       /**< all ones in lanes that have no solution */
+} batch;
+
+/**
+ * @brief Set up lane l of b from puzzle, or as a dead lane if puzzle is NULL.
+ */
+static void load_lane(batch *b, int l, const char *puzzle)
+{
+    int i, d;
+
+    for (i = 0; i < 81; i++) {
+        d = puzzle != NULL ? puzzle[i] - '1' : -1;
+        if (d >= 0 && d <= 8) {
+            b->cand[i][l] = 0;
+            b->value[i][l] = 1u << d;
+        } else {
+            b->cand[i][l] = puzzle != NULL ? ALL_DIGITS : 0;
+            b->value[i][l] = 0;
+        }
+    }
+    b->dead[l] = puzzle != NULL ? 0 : 0xffff;
+}
+
+/**
+ * @brief Write lane l of b to buf as a puzzle string, '.' for empty cells.
+ * @return number of empty cells
+ */
+static int store_lane(const batch *b, int l, char *buf)
+{
+    unsigned v;
+    int i, d, empty = 0;
+
+    for (i = 0; i < 81; i++) {
+        if ((v = b->value[i][l]) == 0) {
+            buf[i] = '.';
+            empty++;
+            continue;
+        }
+        for (d = 0; !(v & 1u << d); d++)
+            ;
+        buf[i] = '1' + d;
+    }
+    buf[81] = '\0';
+    return empty;
+}
+
+/** @brief Propagate every lane of b until no lane places another digit. */
+BATCH_CLONES
+static void propagate(batch *b)
+{
+    const unsigned char *cells;
+    lanes   zero = {0};
+    lanes   used[27];
+    lanes   once, twice, v, m, placed;
+    int     u, k, c;
+
+    for (;;) {
+        /* placed digits leave their units' candidates; twice is a conflict */
+        for (u = 0; u < 27; u++) {
+            cells = sudoku_unit_cells[u];
+            once = twice = zero;
+            for (k = 0; k < 9; k++) {
+                v = b->value[cells[k]];
+                twice |= once & v;
+                once |= v;
+            }
+            b->dead |= (lanes) (twice != 0);
+            used[u] = once;
+            for (k = 0; k < 9; k++)
+                b->cand[cells[k]] &= ~once;
+        }
+
+        /* hidden singles; a digit with nowhere to go is a conflict */
+        for (u = 0; u < 27; u++) {
+            cells = sudoku_unit_cells[u];
+            once = twice = zero;
+            for (k = 0; k < 9; k++) {
+                v = b->cand[cells[k]];
+                twice |= once & v;
+                once |= v;
+            }
+            b->dead |= (lanes) ((once | used[u]) != ALL_DIGITS);
+            once &= ~twice;
+            for (k = 0; k < 9; k++) {
+                v = b->cand[cells[k]] & once;
+                m = (lanes) (v != 0);
+                b->cand[cells[k]] = v | (b->cand[cells[k]] & ~m);
+            }
+        }
+
+        /* naked singles, which now include the hidden ones */
+        placed = zero;
+        for (c = 0; c < 81; c++) {
+            v = b->cand[c];
+            m = (lanes) (v != 0) & (lanes) ((v & (v - 1)) == 0);
+            b->dead |= (lanes) ((v | b->value[c]) == 0);
+            b->value[c] |= v & m;
+            b->cand[c] = v & ~m;
+            placed |= m;
+        }
+
+        placed &= ~b->dead;
+        for (k = 0; k < SUDOKU_BATCH_LANES && placed[k] == 0; k++)
+            ;
+        if (k == SUDOKU_BATCH_LANES)
+            break;
+    }
+}
+
+#endif
+
+/**
+ * @brief Solve one puzzle with DLX, like sudoku_dlx_nsolve.
+ * @return number of solutions found, up to max
+ */
+static size_t dlx_nsolve(sudoku_dlx *fallback, const char *puzzle,
+                         char *solution, size_t max)
+{
+    if (sudoku_load_givens(fallback, puzzle) < 0)
+        return 0;
+    if (max == 1)
+        return sudoku_dlx_solve(fallback, solution);
+    return sudoku_dlx_nsolve(fallback, solution, max);
+}
+
+/**
+ * @brief Tries to find up to max solutions of each of n puzzles, like
+ * sudoku_dlx_nsolve on each.
+ *
+ * The puzzles are propagated SUDOKU_BATCH_LANES at a time; those that need
+ * searching are finished on fallback, whose givens are left changed.
+ *
+ * @param fallback  an initialised solver context
+ * @param puzzles   n puzzles in the format described in sudoku_solve; they
+ *                  need not be null terminated
+ * @param solutions solutions[i] gets the first solution found for puzzles[i]
+ *                  and a null terminator, if counts[i] is not 0
+ * @param counts    counts[i] gets the number of solutions of puzzles[i]
+ *                  found, up to max: 0 if unsolvable
+ * @param max       maximum number of solutions to look for, at least 1
+ * @return number of puzzles that needed the DLX search
+ */
+size_t sudoku_batch_nsolve(sudoku_dlx *fallback, const char *puzzles[],
+                           char solutions[][82], size_t counts[],
+                           size_t n, size_t max)
+{
+    size_t  i, searched = 0;
+#ifdef HAVE_BATCH_VECTORS
+    batch   b;
+    size_t  base;
+    int     l;
+
+    for (base = 0; base < n; base += SUDOKU_BATCH_LANES) {
+        for (l = 0; l < SUDOKU_BATCH_LANES; l++)
+            load_lane(&b, l, base + l < n ? puzzles[base + l] : NULL);
+        propagate(&b);
+
+        for (l = 0; l < SUDOKU_BATCH_LANES && base + l < n; l++) {
+            i = base + l;
+            if (b.dead[l]) {
+                counts[i] = 0;
+            } else if (store_lane(&b, l, solutions[i]) == 0) {
+                counts[i] = 1;      /* forced all the way: unique */
+            } else {
+                counts[i] = dlx_nsolve(fallback, solutions[i], solutions[i],
+                                       max);
+                searched++;
+            }
+        }
+    }
+#else
+    for (i = 0; i < n; i++)
+        counts[i] = dlx_nsolve(fallback, puzzles[i], solutions[i], max);
+    searched = n;
+#endif
+    return searched;
+}
+
+/** @return name of the propagation code sudoku_batch_nsolve uses here */
+const char *sudoku_batch_kernel(void)
+{
+#if defined(HAVE_BATCH_CLONES)
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#elif defined(HAVE_BATCH_VECTORS)
+    return "vector";
+#else
+    return "none";
+#endif
+}
@@ -0,0 +1,402 @@
+/**
+ * @file
+ * @brief Bitboard sudoku solver, specialised for 9x9 grids.
+ *
+ * Instead of a DLX matrix, the board is kept as one 9-bit candidate mask per
+ * cell (bit d set if digit d + 1 can still go there).  Placing a digit clears
+ * its bit in the cell's 20 peers, and each step picks the empty cell with the
+ * fewest candidates (minimum remaining values, MRV): no choice left means
+ * backtrack, one means a naked single is placed without branching, and
+ * otherwise the search branches on a copy of the board for each candidate.
+ * Before branching, every row, column and region is also checked for hidden
+ * singles (a digit with only one place left in the unit), and for digits with
+ * no place at all, which mean the board has no solution.
+ *
+ * Picking the MRV cell means a popcount and a minimum over all 81 masks, every
+ * step, which is where the time goes.  The masks are 16 bits wide and padded
+ * to SUDOKU_BITS_CELLS, so the scan can be done 8 cells at a time with SSE2 or
+ * 16 at a time with AVX2; the widest kernel the CPU supports is picked at run
+ * time, with a plain C kernel for everything else.  All kernels pick the same
+ * cell (the first one with the fewest candidates), so the engine's answers do
+ * not depend on the CPU.  The environment variable SUDOKU_BITS_KERNEL can be
+ * set to "scalar", "sse2" or "avx2" to force a narrower kernel; it is read
+ * once, on the first solve.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sudoku.h"
+#include "sudoku_bits.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#define ALL_DIGITS  0x1ff   /* candidate mask of an empty, unconstrained cell */
+#define FILLED      0x10    /* MRV key bias of a filled cell; above any count */
+
+/** @brief A partly filled board. */
+typedef struct {
+    unsigned short cand[SUDOKU_BITS_CELLS];  /**< candidates, 0 when filled */
+    unsigned short full[SUDOKU_BITS_CELLS];  /**< FILLED for filled cells and
+                                                  the padding, else 0 */
+    char    grid[81];                        /**< '1' - '9', or '.' */
+} board;
+
+/**
+ * @brief MRV kernel: find the first cell with the fewest candidates.
+ * @param count     set to that number of candidates, or to FILLED or more if
+ *                  every cell is filled
+ * @return the cell
+ */
+typedef int (*mrv_kernel)(const board *b, int *count);
+
+/** @brief State shared by every level of one search. */
+typedef struct {
+    mrv_kernel  mrv;
+    size_t      found;  /**< solutions found so far */
+    size_t      max;    /**< stop after this many */
+    char        *buf;   /**< gets the first solution, if not NULL */
+} search_state;
+
+/**
+ * @name GROUP_BITS_KERNELS
+ * MRV kernels.  Each cell's key is the popcount of its candidate mask,
+ * computed SWAR style within a 16-bit lane, ORed with its full mask; the key
+ * is shifted up and the cell number put in the low CELL_BITS bits, so the
+ * smallest of these values is the first cell with the smallest key, and the
+ * kernels need nothing but a running minimum.
+ * @{
+ */
+
+#define CELL_BITS   7
+#define CELL_MASK   ((1 << CELL_BITS) - 1)
+
+/** cell numbers, for the low bits of the vector kernels' values */
+static const unsigned short cell_ids[SUDOKU_BITS_CELLS] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+    48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+    80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95
+};
+
+/** @brief popcount of a 16-bit mask, the same way the vector kernels do it */
+static int popcount16(unsigned v)
+{
+    v = v - ((v >> 1) & 0x5555);
+    v = (v & 0x3333) + ((v >> 2) & 0x3333);
+    v = (v + (v >> 4)) & 0x0f0f;
+    return (v + (v >> 8)) & 0x1f;
+}
+
+static int mrv_scalar(const board *b, int *count)
+{
+    int i, key;
+    int best = 0x7fff, besti = 0;
+
+    for (i = 0; i < 81; i++) {
+        key = popcount16(b->cand[i]) | b->full[i];
+        if (key < best) {
+            best = key;
+            besti = i;
+            if (key == 0)   /* cannot do better; first one wins anyway */
+                break;
+        }
+    }
+    *count = best;
+    return besti;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/** @brief the smallest of the 8 values in v, as the cell, setting *count */
+__attribute__((target("sse2")))
+static int min_lane_sse2(__m128i v, int *count)
+{
+    int min;
+
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_epi16(v, _mm_srli_epi32(v, 16));
+    min = _mm_cvtsi128_si32(v) & 0xffff;
+    *count = min >> CELL_BITS;
+    return min & CELL_MASK;
+}
+
+__attribute__((target("sse2")))
+static int mrv_sse2(const board *b, int *count)
+{
+    const __m128i m1 = _mm_set1_epi16(0x5555);
+    const __m128i m2 = _mm_set1_epi16(0x3333);
+    const __m128i m4 = _mm_set1_epi16(0x0f0f);
+    const __m128i m8 = _mm_set1_epi16(0x001f);
+    __m128i best = _mm_set1_epi16(0x7fff);
+    __m128i v;
+    int i;
+
+    for (i = 0; i < SUDOKU_BITS_CELLS; i += 8) {
+        v = _mm_loadu_si128((const __m128i *) (b->cand + i));
+        v = _mm_sub_epi16(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+        v = _mm_add_epi16(_mm_and_si128(v, m2),
+                          _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+        v = _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 4)), m4);
+        v = _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), m8);
+        v = _mm_or_si128(v, _mm_loadu_si128((const __m128i *) (b->full + i)));
+        v = _mm_or_si128(_mm_slli_epi16(v, CELL_BITS),
+                         _mm_loadu_si128((const __m128i *) (cell_ids + i)));
+        best = _mm_min_epi16(best, v);
+    }
+    return min_lane_sse2(best, count);
+}
+
+__attribute__((target("avx2")))
+static int mrv_avx2(const board *b, int *count)
+{
+    const __m256i m1 = _mm256_set1_epi16(0x5555);
+    const __m256i m2 = _mm256_set1_epi16(0x3333);
+    const __m256i m4 = _mm256_set1_epi16(0x0f0f);
+    const __m256i m8 = _mm256_set1_epi16(0x001f);
+    __m256i best = _mm256_set1_epi16(0x7fff);
+    __m256i v;
+    __m128i half;
+    int i, min;
+
+    for (i = 0; i < SUDOKU_BITS_CELLS; i += 16) {
+        v = _mm256_loadu_si256((const __m256i *) (b->cand + i));
+        v = _mm256_sub_epi16(v, _mm256_and_si256(_mm256_srli_epi16(v, 1), m1));
+        v = _mm256_add_epi16(_mm256_and_si256(v, m2),
+                             _mm256_and_si256(_mm256_srli_epi16(v, 2), m2));
+        v = _mm256_and_si256(_mm256_add_epi16(v, _mm256_srli_epi16(v, 4)), m4);
+        v = _mm256_and_si256(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), m8);
+        v = _mm256_or_si256(v,
+                _mm256_loadu_si256((const __m256i *) (b->full + i)));
+        v = _mm256_or_si256(_mm256_slli_epi16(v, CELL_BITS),
+                _mm256_loadu_si256((const __m256i *) (cell_ids + i)));
+        best = _mm256_min_epi16(best, v);
+    }
+
+    /* fold to 8 lanes; SSE4.1 (implied by AVX2) finds the minimum lane */
+    half = _mm_min_epu16(_mm256_castsi256_si128(best),
+                         _mm256_extracti128_si256(best, 1));
+    min = _mm_cvtsi128_si32(_mm_minpos_epu16(half)) & 0xffff;
+    *count = min >> CELL_BITS;
+    return min & CELL_MASK;
+}
+
+#endif
+
+/** @brief The kernels, narrowest first */
+static const struct {
+    mrv_kernel  mrv;
+    const char  *name;
+} kernels[] = {
+    {mrv_scalar, "scalar"}
+#ifdef HAVE_X86_KERNELS
+    , {mrv_sse2, "sse2"}, {mrv_avx2, "avx2"}
+#endif
+};
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+static int kernel_choice;   /* index into kernels[], set by choose_kernel */
+
+/**
+ * @brief Pick the widest kernel the CPU supports, unless SUDOKU_BITS_KERNEL
+ * asks for a narrower one.  Only ever run once, through pthread_once.
+ */
+static void choose_kernel(void)
+{
+    const char *want;
+    int k = 0;
+
+    if ((want = getenv("SUDOKU_BITS_KERNEL")) == NULL)
+        want = "";
+#ifdef HAVE_X86_KERNELS
+    if (strcmp(want, "scalar") != 0 && __builtin_cpu_supports("sse2"))
+        k = 1;
+    if (k == 1 && strcmp(want, "sse2") != 0 && __builtin_cpu_supports("avx2"))
+        k = 2;
+#endif
+    kernel_choice = k;
+}
+
+/** @return the kernel to use, chosen on the first call from any thread */
+static mrv_kernel select_kernel(const char **name)
+{
+    pthread_once(&kernel_once, choose_kernel);
+    *name = kernels[kernel_choice].name;
+    return kernels[kernel_choice].mrv;
+}
+
+/** @} */
+
+/** @brief Put digit d (0 - 8) in cell and take it out of the peers' masks */
+static void place(board *b, int cell, int d)
+{
+    unsigned short mask = ~(1u << d);
+    int r = cell / 9, c = cell % 9;
+    int box = r / 3 * 27 + c / 3 * 3;
+    int k;
+
+    for (k = 0; k < 9; k++) {
+        b->cand[r * 9 + k] &= mask;
+        b->cand[k * 9 + c] &= mask;
+        b->cand[box + k / 3 * 9 + k % 3] &= mask;
+    }
+    b->cand[cell] = 0;
+    b->full[cell] = FILLED;
+    b->grid[cell] = '1' + d;
+}
+
+/**
+ * @brief Set up b from puzzle.
+ * @return 0 on success, -1 if two givens conflict
+ */
+static int load(board *b, const char *puzzle)
+{
+    int i, d;
+
+    for (i = 0; i < SUDOKU_BITS_CELLS; i++) {
+        b->cand[i] = i < 81 ? ALL_DIGITS : 0;
+        b->full[i] = i < 81 ? 0 : FILLED;
+    }
+    memset(b->grid, '.', sizeof(b->grid));
+
+    for (i = 0; i < 81; i++) {
+        d = puzzle[i] - '1';
+        if (d < 0 || d > 8)
+            continue;
+        if (!(b->cand[i] & 1u << d))
+            return -1;
+        place(b, i, d);
+    }
+    return 0;
+}
+
+/**
+ * @brief Place every hidden single on the board.
+ * @return 1 if any were placed, 0 if there were none, -1 if some digit has
+ *          no place left in a unit (or two have only the same cell)
+ */
+static int hidden_singles(board *b)
+{
+    const unsigned char *cells;
+    unsigned once, twice, placed, single, m;
+    int u, k, d, found = 0;
+
+    for (u = 0; u < 27; u++) {
+        cells = sudoku_unit_cells[u];
+        once = twice = placed = 0;
+        for (k = 0; k < 9; k++) {
+            m = b->cand[cells[k]];
+            if (b->grid[cells[k]] != '.')
+                placed |= m = 1u << (b->grid[cells[k]] - '1');
+            twice |= once & m;
+            once |= m;
+        }
+        if (once != ALL_DIGITS)
+            return -1;
+        if ((single = once & ~twice & ~placed) == 0)
+            continue;
+        for (k = 0; k < 9; k++) {
+            if ((m = b->cand[cells[k]] & single) == 0)
+                continue;
+            if (m & (m - 1))    /* two digits that can only go here */
+                return -1;
+            for (d = 0; !(m & 1u << d); d++)
+                ;
+            place(b, cells[k], d);
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/** @brief Solve b, placing naked and hidden singles in place and branching otherwise */
+static void search(search_state *st, board *b)
+{
+    board   next;
+    int     cell, count, d;
+    unsigned m;
+
+    for (;;) {
+        cell = st->mrv(b, &count);
+        if (count >= FILLED) {      /* every cell filled: a solution */
+            if (st->found++ == 0 && st->buf != NULL) {
+                memcpy(st->buf, b->grid, 81);
+                st->buf[81] = '\0';
+            }
+            return;
+        }
+        if (count == 0)             /* empty cell with no candidates */
+            return;
+        if (count == 1) {
+            for (d = 0; !(b->cand[cell] & 1u << d); d++)
+                ;
+            place(b, cell, d);
+            continue;
+        }
+        if ((d = hidden_singles(b)) < 0)
+            return;
+        if (d == 0)
+            break;
+    }
+
+    m = b->cand[cell];
+    for (d = 0; d < 9; d++) {
+        if (!(m & 1u << d))
+            continue;
+        next = *b;
+        place(&next, cell, d);
+        search(st, &next);
+        if (st->found >= st->max)
+            return;
+    }
+}
+
+/**
+ * @brief Tries to find up to n solutions, like sudoku_nsolve.
+ *
+ * @param puzzle    81 characters in the format described in sudoku_solve; it
+ *                  need not be null terminated
+ * @param buf       gets the first solution found and a null terminator if not
+ *                  NULL; must hold 82 characters
+ * @param n         maximum number of solutions to look for, at least 1
+ * @return 0 if unsolvable, else, number of solutions found
+ */
+size_t sudoku_bits_nsolve(const char *puzzle, char *buf, size_t n)
+{
+    board b;
+    search_state st;
+    const char *name;
+
+    if (load(&b, puzzle) != 0)
+        return 0;
+    st.mrv = select_kernel(&name);
+    st.found = 0;
+    st.max = n;
+    st.buf = buf;
+    search(&st, &b);
+    return st.found;
+}
+
+/**
+ * @brief Solves puzzle and puts the solution in buf, like sudoku_solve.
+ * @return 0 if unsolvable, 1 if solution found
+ */
+int sudoku_bits_solve(const char *puzzle, char *buf)
+{
+    return sudoku_bits_nsolve(puzzle, buf, 1) > 0;
+}
+
+/** @return name of the MRV kernel the solver functions use on this CPU */
+const char *sudoku_bits_kernel(void)
+{
+    const char *name;
+
+    select_kernel(&name);
+    return name;
+}
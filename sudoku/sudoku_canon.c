@@ -0,0 +1,488 @@
+/**
+ * @file
+ * @brief Canonical forms of puzzles under the sudoku symmetry group, and a
+ * solution cache keyed by them.
+ *
+ * The symmetries used are the ones that map every valid grid to a valid grid:
+ * relabelling the digits, permuting the rows within a band and the bands
+ * themselves, the same for columns and stacks, and transposing.  Ignoring the
+ * digits, that is 2 * 6^4 * 6^4 = 3359232 cell arrangements.
+ *
+ * The canonical form of a puzzle is the least of its images, compared column
+ * by column (top to bottom, left to right), with blanks as 0 and the digits
+ * relabelled 1, 2, 3, ... in order of first appearance.  The search places
+ * the rows top to bottom and then the columns left to right, as a branch and
+ * bound against the best image so far: a partial image is cut off as soon as
+ * one of its columns compares greater, and a partial row arrangement as soon
+ * as no choice of first column can keep up with the best one.
+ *
+ * Highly symmetric puzzles (an almost empty grid, for example) have many ties
+ * and defeat the pruning, so the search gives up after CANON_BUDGET column
+ * placements and keeps the best image found.  That image is still an
+ * equivalent puzzle with a known transform, so the cache stays correct; it
+ * may just miss on a puzzle it has effectively seen before.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sudoku_canon.h"
+
+#define CANON_BUDGET 100000UL
+
+typedef struct {
+    unsigned char src[81];      /**< puzzle values 0 - 9, maybe transposed */
+    unsigned char rows[9];      /**< row arrangement, up to current depth */
+    unsigned char cols[9];      /**< column arrangement, up to current depth */
+    unsigned char lab[10];      /**< digit relabelling, 0 if not yet used */
+    int           nlab;         /**< number of labels handed out */
+    unsigned char lab0[9][10];  /**< relabelling if column c comes first */
+    int           nlab0[9];
+    unsigned int  used_rows;    /**< bit r set if row r has been placed */
+    unsigned int  used_cols;    /**< bit c set if column c has been placed */
+    unsigned char cur[81];      /**< image being built, column major */
+    unsigned char best[81];     /**< least image so far, column major */
+    unsigned char best_rows[9];
+    unsigned char best_cols[9];
+    unsigned char best_lab[10];
+    int           transposed;   /**< src is the transposed puzzle */
+    int           best_transposed;
+    int           have_best;
+    unsigned long budget;       /**< search nodes left */
+} canon_state;
+
+/** @return value of puzzle character: 1 - 9, or 0 for a blank */
+static int cell_value(int c)
+{
+    return c >= '1' && c <= '9' ? c - '0' : 0;
+}
+
+/**
+ * @brief The rows (or columns) that may go in position i, given the ones in
+ * positions 0 .. i - 1: the rest of the band the previous one came from, or
+ * any row of a band not started yet.
+ * @return bit r set if row r may go in position i
+ */
+static unsigned int next_lines(const unsigned char placed[], int i,
+                               unsigned int used)
+{
+    unsigned int m = 0;
+    int b;
+
+    if (i % 3 != 0)
+        return 07u << placed[i - 1] / 3 * 3 & ~used;
+    for (b = 0; b < 9; b += 3)
+        if (!(used & 07u << b))
+            m |= 07u << b;
+    return m;
+}
+
+/**
+ * @brief Place column j of the image, and recursively the ones after it.
+ *
+ * Every candidate column is built, and only those that come out least are
+ * explored further: whatever follows, an image with a greater column j is
+ * greater.  The least candidate is then compared with the best image so far.
+ *
+ * @param eq    nonzero if columns 0 .. j - 1 equal those of the best image;
+ *              otherwise they are smaller (bigger prefixes are never
+ *              explored)
+ * @param cand  bit c set if column c may be placed at j
+ * @return nonzero if the best image was replaced
+ */
+static int place_col(canon_state *s, int j, int eq, unsigned int cand)
+{
+    unsigned char cols[9][9];
+    unsigned char labs[9][10];
+    unsigned char lab[10];
+    unsigned char *least = NULL;
+    unsigned int keep = 0;
+    int nlabs[9];
+    int c, i, v, cmp, nlab;
+    int updated = 0;
+
+    if (j == 9) {
+        if (eq)
+            return 0;   /* a tie; keep the first one */
+        memcpy(s->best, s->cur, sizeof(s->best));
+        memcpy(s->best_rows, s->rows, sizeof(s->rows));
+        memcpy(s->best_cols, s->cols, sizeof(s->cols));
+        memcpy(s->best_lab, s->lab, sizeof(s->lab));
+        s->best_transposed = s->transposed;
+        s->have_best = 1;
+        return 1;
+    }
+
+    if (s->have_best) {
+        if (s->budget == 0)
+            return 0;
+        s->budget--;
+    }
+
+    /* build every candidate, labelling new digits as they appear */
+    for (c = 0; c < 9; c++) {
+        if (!(cand & 1u << c))
+            continue;
+        memcpy(labs[c], s->lab, sizeof(s->lab));
+        nlabs[c] = s->nlab;
+        for (i = 0; i < 9; i++) {
+            v = s->src[s->rows[i] * 9 + c];
+            if (v && !labs[c][v])
+                labs[c][v] = ++nlabs[c];
+            cols[c][i] = labs[c][v];
+        }
+        cmp = least == NULL ? -1 : memcmp(cols[c], least, 9);
+        if (cmp < 0) {
+            least = cols[c];
+            keep = 0;
+        }
+        if (cmp <= 0)
+            keep |= 1u << c;
+    }
+
+    cmp = eq ? memcmp(least, s->best + 9 * j, 9) : -1;
+    if (cmp > 0)
+        return 0;
+
+    memcpy(s->cur + 9 * j, least, 9);
+    memcpy(lab, s->lab, sizeof(lab));
+    nlab = s->nlab;
+    for (c = 0; c < 9; c++) {
+        if (!(keep & 1u << c))
+            continue;
+        s->cols[j] = c;
+        s->used_cols |= 1u << c;
+        memcpy(s->lab, labs[c], sizeof(s->lab));
+        s->nlab = nlabs[c];
+        if (place_col(s, j + 1, cmp == 0,
+                      next_lines(s->cols, j + 1, s->used_cols))) {
+            /* the best image now starts with the current prefix */
+            updated = 1;
+            cmp = 0;
+        }
+        s->used_cols &= ~(1u << c);
+    }
+    memcpy(s->lab, lab, sizeof(lab));
+    s->nlab = nlab;
+    return updated;
+}
+
+/**
+ * @brief Place row i of the image, and recursively the ones after it, then
+ * search the column arrangements.
+ *
+ * The first column of the image is one of the 9 puzzle columns, and it is
+ * compared before anything else, so only the rows that make it least are
+ * worth trying.  Each candidate first column gets its own relabelling, and
+ * the row (and first column) candidates kept are those giving the least
+ * value at row i of the first column.
+ *
+ * @param eq    nonzero if rows 0 .. i - 1 of the first column equal those of
+ *              the best image; otherwise they are smaller
+ * @param first bit c set if column c can still come first
+ */
+static void place_row(canon_state *s, int i, int eq, unsigned int first)
+{
+    unsigned int rows = next_lines(s->rows, i, s->used_rows);
+    unsigned char vals[9][9];
+    unsigned int keep, newly;
+    int least = 10;
+    int r, c, v;
+
+    if (i == 9) {
+        place_col(s, 0, s->have_best, first);
+        return;
+    }
+
+    /* value each candidate row would put in each candidate first column */
+    for (r = 0; r < 9; r++) {
+        if (!(rows & 1u << r))
+            continue;
+        for (c = 0; c < 9; c++) {
+            if (!(first & 1u << c))
+                continue;
+            v = s->src[r * 9 + c];
+            vals[r][c] = v && !s->lab0[c][v] ? s->nlab0[c] + 1 : s->lab0[c][v];
+            if (vals[r][c] < least)
+                least = vals[r][c];
+        }
+    }
+
+    if (eq && s->have_best) {
+        if (least > s->best[i])
+            return;
+        eq = least == s->best[i];
+    }
+
+    for (r = 0; r < 9; r++) {
+        if (!(rows & 1u << r))
+            continue;
+        keep = newly = 0;
+        for (c = 0; c < 9; c++)
+            if ((first & 1u << c) && vals[r][c] == least)
+                keep |= 1u << c;
+        if (!keep)
+            continue;
+
+        s->rows[i] = r;
+        s->used_rows |= 1u << r;
+        for (c = 0; c < 9; c++) {
+            v = s->src[r * 9 + c];
+            if ((keep & 1u << c) && v && !s->lab0[c][v]) {
+                s->lab0[c][v] = ++s->nlab0[c];
+                newly |= 1u << c;
+            }
+        }
+
+        place_row(s, i + 1, eq, keep);
+
+        for (c = 0; c < 9; c++) {
+            if (newly & 1u << c) {
+                s->lab0[c][s->src[r * 9 + c]] = 0;
+                s->nlab0[c]--;
+            }
+        }
+        s->used_rows &= ~(1u << r);
+    }
+}
+
+/**
+ * @brief Find the canonical form of puzzle and the transform that maps the
+ * puzzle to it.
+ *
+ * @param canon     filled with the canonical puzzle, '.' for blanks; must
+ *                  have room for 82 char: 81 + null terminator
+ * @param t         filled with the transform from puzzle to canon, with every
+ *                  digit mapped (digits not in puzzle in increasing order)
+ * @return 1 if canon is the canonical form, 0 if the search ran out of
+ *         CANON_BUDGET first and canon is only the least image it found
+ */
+int sudoku_canonicalize(const char *puzzle, char *canon, sudoku_transform *t)
+{
+    canon_state state;
+    canon_state *s = &state;
+    int i, j, b, next;
+
+    memset(s, 0, sizeof(*s));
+    s->budget = CANON_BUDGET;
+
+    for (s->transposed = 0; s->transposed < 2; s->transposed++) {
+        for (i = 0; i < 81; i++)
+            s->src[i] = cell_value(s->transposed ?
+                                   puzzle[i % 9 * 9 + i / 9] : puzzle[i]);
+        place_row(s, 0, 1, 0x1ff);
+    }
+
+    /* canonical cell (i, j) is column major best[9 * j + i] */
+    for (i = 0; i < 9; i++)
+        for (j = 0; j < 9; j++) {
+            b = s->best[9 * j + i];
+            canon[9 * i + j] = b ? '0' + b : '.';
+            t->cells[9 * i + j] = s->best_transposed ?
+                s->best_cols[j] * 9 + s->best_rows[i] :
+                s->best_rows[i] * 9 + s->best_cols[j];
+        }
+    canon[81] = '\0';
+
+    next = 0;
+    for (i = 1; i < 10; i++)
+        if (s->best_lab[i] > next)
+            next = s->best_lab[i];
+    t->digits[0] = 0;
+    for (i = 1; i < 10; i++)
+        t->digits[i] = s->best_lab[i] ? s->best_lab[i] : ++next;
+    return s->budget > 0;
+}
+
+/**
+ * @brief dst = t applied to src
+ * @param dst   must have room for 82 char; blanks are written as '.'
+ */
+void sudoku_transform_apply(const sudoku_transform *t, const char *src,
+                            char *dst)
+{
+    int i, v;
+    for (i = 0; i < 81; i++) {
+        v = t->digits[cell_value(src[t->cells[i]])];
+        dst[i] = v ? '0' + v : '.';
+    }
+    dst[81] = '\0';
+}
+
+/**
+ * @brief dst = inverse of t applied to src, e.g. to map the solution of a
+ * canonical puzzle back to the original puzzle
+ * @param dst   must have room for 82 char; blanks are written as '.'
+ */
+void sudoku_transform_invert(const sudoku_transform *t, const char *src,
+                             char *dst)
+{
+    unsigned char inv[10];
+    int i, v;
+
+    for (i = 0; i < 10; i++)
+        inv[t->digits[i]] = i;
+    for (i = 0; i < 81; i++) {
+        v = inv[cell_value(src[i])];
+        dst[t->cells[i]] = v ? '0' + v : '.';
+    }
+    dst[81] = '\0';
+}
+
+/**
+ * @name GROUP_SUDOKU_CACHE
+ * The cache is a fixed array of entries, chained into hash buckets and into
+ * a doubly linked LRU list by index.  When it is full, the least recently
+ * used entry is recycled.  A cache is not safe to share between threads.
+ * @{
+ */
+
+/** @brief FNV-1a hash of an 81 char canonical puzzle */
+static unsigned long hash81(const char *key)
+{
+    unsigned long h = 2166136261ul;
+    int i;
+    for (i = 0; i < 81; i++)
+        h = ((h ^ (unsigned char) key[i]) * 16777619ul) & 0xfffffffful;
+    return h;
+}
+
+/** @brief remove entry i from the LRU list */
+static void lru_unlink(sudoku_cache *cache, int i)
+{
+    sudoku_cache_entry *e = cache->entries + i;
+
+    if (e->prev >= 0)
+        cache->entries[e->prev].next = e->next;
+    else
+        cache->head = e->next;
+    if (e->next >= 0)
+        cache->entries[e->next].prev = e->prev;
+    else
+        cache->tail = e->prev;
+}
+
+/** @brief insert entry i at the front (most recently used end) */
+static void lru_push(sudoku_cache *cache, int i)
+{
+    sudoku_cache_entry *e = cache->entries + i;
+
+    e->prev = -1;
+    e->next = cache->head;
+    if (cache->head >= 0)
+        cache->entries[cache->head].prev = i;
+    else
+        cache->tail = i;
+    cache->head = i;
+}
+
+/** @brief remove entry i from its hash bucket */
+static void hash_unlink(sudoku_cache *cache, int i)
+{
+    int *p = cache->buckets
+             + (cache->entries[i].hash & (cache->nbuckets - 1));
+
+    while (*p != i)
+        p = &cache->entries[*p].hnext;
+    *p = cache->entries[i].hnext;
+}
+
+/**
+ * @brief allocate a cache of size entries
+ * @return 0 on success, -1 on failure
+ */
+int sudoku_cache_init(sudoku_cache *cache, size_t size)
+{
+    size_t i;
+
+    for (cache->nbuckets = 1; cache->nbuckets < size; cache->nbuckets <<= 1)
+        ;
+    cache->entries = malloc(sizeof(*cache->entries) * size);
+    cache->buckets = malloc(sizeof(*cache->buckets) * cache->nbuckets);
+    cache->puzzle_dlx = malloc(sizeof(*cache->puzzle_dlx));
+    if (size == 0 || cache->entries == NULL || cache->buckets == NULL
+            || cache->puzzle_dlx == NULL) {
+        sudoku_cache_free(cache);
+        return -1;
+    }
+
+    for (i = 0; i < cache->nbuckets; i++)
+        cache->buckets[i] = -1;
+    cache->size = size;
+    cache->used = 0;
+    cache->head = cache->tail = -1;
+    cache->hits = cache->misses = 0;
+    sudoku_dlx_init(cache->puzzle_dlx);
+    return 0;
+}
+
+/** @brief release the memory allocated by sudoku_cache_init */
+void sudoku_cache_free(sudoku_cache *cache)
+{
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache->puzzle_dlx);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    cache->puzzle_dlx = NULL;
+}
+
+/**
+ * @brief sudoku_nsolve(puzzle, buf, 2), answered from the cache when an
+ * equivalent puzzle has been seen before.
+ *
+ * @param buf   filled with the solution if not NULL and there is one; must
+ *              have room for 82 char
+ * @return 0 if unsolvable, 1 if the solution is unique, 2 if there is more
+ *         than one solution
+ */
+int sudoku_cache_nsolve(sudoku_cache *cache, const char *puzzle, char *buf)
+{
+    sudoku_transform t;
+    sudoku_cache_entry *e;
+    char canon[82];
+    char solution[82];
+    unsigned long h;
+    int i, *bucket;
+
+    sudoku_canonicalize(puzzle, canon, &t);
+    h = hash81(canon);
+    bucket = cache->buckets + (h & (cache->nbuckets - 1));
+
+    for (i = *bucket; i >= 0; i = cache->entries[i].hnext)
+        if (cache->entries[i].hash == h
+                && memcmp(cache->entries[i].key, canon, 81) == 0)
+            break;
+
+    if (i >= 0) {
+        cache->hits++;
+        lru_unlink(cache, i);
+    } else {
+        cache->misses++;
+        if (cache->used < cache->size) {
+            i = cache->used++;
+        } else {                /* recycle the least recently used entry */
+            i = cache->tail;
+            lru_unlink(cache, i);
+            hash_unlink(cache, i);
+        }
+        e = cache->entries + i;
+        memcpy(e->key, canon, 81);
+        e->hash = h;
+        e->hnext = *bucket;
+        *bucket = i;
+
+        e->nsolutions = 0;
+        if (sudoku_load_givens(cache->puzzle_dlx, canon) >= 0)
+            e->nsolutions = sudoku_dlx_nsolve(cache->puzzle_dlx, solution, 2);
+        if (e->nsolutions > 0)
+            memcpy(e->solution, solution, 81);
+    }
+    lru_push(cache, i);
+
+    e = cache->entries + i;
+    if (buf != NULL && e->nsolutions > 0)
+        sudoku_transform_invert(&t, e->solution, buf);
+    return e->nsolutions;
+}
+
+/** @} */
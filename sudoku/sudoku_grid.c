@@ -6,9 +6,18 @@
  * to fill in a blank cell or undo.  The board can be unfixed at any time, but
  * doing so wipes the given list immediately.  The values are stored as
  * characters, so 1 is represented by ASCII '1', not the value 1.
+ *
+ * Every change to a cell also updates how many times its digit appears in
+ * the cell's row, column and region, so the candidates of any cell are
+ * three mask lookups away, and find_hint can look for the next move on the
+ * board as it is, including digits the solver would not have put there.
+ * The same counts give the collisions, and the solution cached when the
+ * givens are fixed gives the wrong entries, both kept as running totals so
+ * a change costs O(1) and nothing is solved again until the givens change.
  */
 
 #include <stddef.h>
+#include <string.h>
 #include "sudoku_grid.h"
 
 /** grid and cell flags */
@@ -18,6 +27,8 @@
 
 #define EMPTY_CELL_VAL ' '
 
+#define ALL_DIGITS  0x1ff
+
 /* hopefully the compiler will be smart enough to inline this by itself */
 /** @brief convert row, column coordinate to an index from 0 to 80 */
 static int rc2index(int r, int c)
@@ -25,6 +36,52 @@ static int rc2index(int r, int c)
     return 9 * (r - 1) + c - 1;
 }
 
+/** @brief set u to the row, column and region of cell i, as unit numbers */
+static void cell_units(int i, int u[3])
+{
+    u[0] = i / 9;
+    u[1] = 9 + i % 9;
+    u[2] = 18 + i / 27 * 3 + i % 9 / 3;
+}
+
+/** @brief add delta (1 or -1) to the count of val in the units of cell i */
+static void count_value(SudokuGrid *board, int i, int val, int delta)
+{
+    int u[3], k, d;
+
+    if (val < '1' || val > '9')
+        return;
+    d = val - '1';
+    cell_units(i, u);
+    for (k = 0; k < 3; k++) {
+        board->count[u[k]][d] += delta;
+        /* a second copy makes a conflict, taking it away ends one */
+        if (board->count[u[k]][d] == 1 + (delta > 0))
+            board->conflicts += delta;
+        if (board->count[u[k]][d] > 0)
+            board->used[u[k]] |= 1 << d;
+        else
+            board->used[u[k]] &= ~(1 << d);
+    }
+}
+
+/** @return 1 if val is a digit in cell i and the cached solution differs */
+static int is_wrong(SudokuGrid *board, int i, int val)
+{
+    return board->solution[0] != '\0' && val >= '1' && val <= '9'
+        && val != board->solution[i];
+}
+
+/** @brief put val in cell i, keeping the unit counts up to date */
+static void put_value(SudokuGrid *board, int i, int val)
+{
+    count_value(board, i, board->cells[i].val, -1);
+    board->wrong -= is_wrong(board, i, board->cells[i].val);
+    board->cells[i].val = val;
+    count_value(board, i, val, 1);
+    board->wrong += is_wrong(board, i, val);
+}
+
 /** @brief initialize grid values */
 void init_board(SudokuGrid *board)
 {
@@ -36,6 +93,11 @@ void init_board(SudokuGrid *board)
         cell->val = EMPTY_CELL_VAL;
         cell->flags = 0;
     }
+    memset(board->count, 0, sizeof(board->count));
+    memset(board->used, 0, sizeof(board->used));
+    board->conflicts = 0;
+    board->wrong = 0;
+    board->solution[0] = '\0';
 }
 
 /**
@@ -97,10 +159,10 @@ int set_value(SudokuGrid *board, int r, int c, int val) {
             return -1;
         else if (val >= '1' && val <= '9') {
             board->undo_list[board->undo_pos++] = i;
-            cell->val = val;
+            put_value(board, i, val);
         }
     } else
-        cell->val = val;
+        put_value(board, i, val);
     return 0;
 }
 
@@ -122,10 +184,12 @@ void toggle_fix_mode(SudokuGrid *board)
 {
     int i, v;
     SudokuCell *cell = board->cells;
-    if (is_fixed(board)) /* unfix all cells */
+    if (is_fixed(board)) { /* unfix all cells */
         for (i = 0; i < 81; i++, cell++)
             cell->flags &= ~ SC_FIXED;
-    else {
+        /* the givens may change, so the solution no longer holds */
+        set_solution(board, NULL);
+    } else {
         /* fix all cells that are filled in */
         for (i = 0; i < 81; i++, cell++) {
             v = cell->val;
@@ -163,7 +227,7 @@ int undo_board(SudokuGrid *board)
     if (board->undo_pos > 0) {
         (board->undo_pos)--;
         i = board->undo_list[board->undo_pos];
-        board->cells[i].val = EMPTY_CELL_VAL;
+        put_value(board, i, EMPTY_CELL_VAL);
     }
     return i;
 }
@@ -175,13 +239,167 @@ int undo_board(SudokuGrid *board)
 void clear_board(SudokuGrid *board)
 {
     int i;
-    SudokuCell *cell = board->cells;
     if (is_fixed(board)) {
         for (i = board->undo_pos; i > 0; i--) 
             undo_board(board);
     } else {
-        for (i = 0; i < 81; i++, cell++)
-            cell->val = EMPTY_CELL_VAL;
+        for (i = 0; i < 81; i++)
+            put_value(board, i, EMPTY_CELL_VAL);
+    }
+}
+
+/**
+ * @brief Cache the solution to the givens, for is_cell_wrong; fixed mode only.
+ * Call it again each time the givens are fixed; unfixing them drops it.
+ * @param solution  81 digits, or NULL if there is no unique solution
+ */
+void set_solution(SudokuGrid *board, const char *solution)
+{
+    int i;
+
+    board->solution[0] = '\0';
+    board->wrong = 0;
+    if (solution == NULL || !is_fixed(board))
+        return;
+    memcpy(board->solution, solution, 81);
+    board->solution[81] = '\0';
+    for (i = 0; i < 81; i++)
+        board->wrong += is_wrong(board, i, board->cells[i].val);
+}
+
+/**
+ * @return nonzero if the solution is known and the value at row r, column c
+ * is not the one it has there, 0 otherwise
+ */
+int is_cell_wrong(SudokuGrid *board, int r, int c)
+{
+    int i = rc2index(r, c);
+    return is_wrong(board, i, board->cells[i].val);
+}
+
+/**
+ * @return nonzero if the value at row r, column c is also in its row, column
+ * or region, 0 otherwise
+ */
+int is_cell_conflict(SudokuGrid *board, int r, int c)
+{
+    int i = rc2index(r, c);
+    int val = board->cells[i].val;
+    int u[3];
+
+    if (val < '1' || val > '9')
+        return 0;
+    cell_units(i, u);
+    val -= '1';
+    return board->count[u[0]][val] > 1 || board->count[u[1]][val] > 1
+        || board->count[u[2]][val] > 1;
+}
+
+/** @return the digits still possible in empty cell i, as a mask */
+static int candidates(SudokuGrid *board, int i)
+{
+    int u[3];
+
+    cell_units(i, u);
+    return ALL_DIGITS & ~(board->used[u[0]] | board->used[u[1]]
+                          | board->used[u[2]]);
+}
+
+/** @return the lowest digit in mask m, as '1' - '9' */
+static int lowest_digit(int m)
+{
+    int d;
+
+    for (d = 0; !(m & 1 << d); d++)
+        ;
+    return '1' + d;
+}
+
+/**
+ * @brief Find the next move on the board as it stands, the way the DLX
+ * search would choose its next column: a column no choice is left for
+ * first, then the first column with exactly one, in column order (cells,
+ * then rows, columns and regions, each digit by digit).
+ *
+ * The counts are kept up to date by every change to the board, so this is
+ * one pass over the 81 cells and the 27 units.
+ *
+ * @return 1 with hint set to a naked or hidden single; -1 with hint set to
+ *          the mistake if an empty cell has no digit left (val is ' '), or a
+ *          unit has no place left for val; 0 if neither is found, and the
+ *          next move needs a harder technique or a guess
+ */
+int find_hint(SudokuGrid *board, SudokuHint *hint)
+{
+    const unsigned char *cells;
+    int cand[81];
+    int i, u, k, m, once, twice, found = 0;
+
+    for (i = 0; i < 81; i++) {
+        k = board->cells[i].val;
+        cand[i] = k >= '1' && k <= '9' ? 0 : candidates(board, i);
+        if (cand[i] == 0 && !(k >= '1' && k <= '9')) {
+            hint->technique = CELL_ID;
+            hint->cell = i;
+            hint->unit = -1;
+            hint->val  = EMPTY_CELL_VAL;
+            return -1;
+        }
+        if (!found && (cand[i] & (cand[i] - 1)) == 0 && cand[i] != 0) {
+            hint->technique = CELL_ID;
+            hint->cell = i;
+            hint->unit = -1;
+            hint->val  = lowest_digit(cand[i]);
+            found = 1;
+        }
+    }
+
+    for (u = 0; u < 27; u++) {
+        /* digits with one place in the unit, and with more than one */
+        cells = sudoku_unit_cells[u];
+        once = twice = 0;
+        for (k = 0; k < 9; k++) {
+            m = cand[cells[k]];
+            twice |= once & m;
+            once  |= m;
+        }
+        once &= ~twice;
+        m = ALL_DIGITS & ~(board->used[u] | once | twice);
+        if (m != 0 || !found) {
+            hint->technique = u < 9 ? ROW_ID : u < 18 ? COL_ID : REGION_ID;
+            hint->unit = u;
+        }
+        if (m != 0) {
+            hint->cell = -1;
+            hint->val  = lowest_digit(m);
+            return -1;
+        }
+        if (!found && once != 0) {
+            hint->val = lowest_digit(once);
+            for (k = 0; !(cand[cells[k]] & 1 << (hint->val - '1')); k++)
+                ;
+            hint->cell = cells[k];
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief The cells to show for hint: its unit, if it has one, or its cell.
+ * @param cells     room for 9
+ * @return number of cells written, 9 or 1
+ */
+int hint_unit_cells(const SudokuHint *hint, int cells[])
+{
+    int k;
+
+    if (hint->unit < 0) {
+        cells[0] = hint->cell;
+        return 1;
     }
+    for (k = 0; k < 9; k++)
+        cells[k] = sudoku_unit_cells[hint->unit][k];
+    return 9;
 }
 
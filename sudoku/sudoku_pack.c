@@ -0,0 +1,273 @@
+/**
+ * @file
+ * @brief Compact binary encodings of puzzles and solutions.
+ *
+ * A puzzle is packed at 4 bits per cell, two cells per byte with the first
+ * cell in the low nibble, for 41 bytes instead of 82.  Blanks are 0 and
+ * digits are themselves.  Unpacking is a table lookup per nibble.
+ *
+ * A solution is packed much tighter.  Every row of a solved grid is a
+ * permutation of 1 - 9, so each row is stored as its rank among the 9! =
+ * 362880 permutations in lexicographic order, which fits in 19 bits.  The
+ * last row is left out since every column is a permutation too, which makes
+ * 8 * 19 = 152 bits, exactly 19 bytes.  An all ones record (rank 2^19 - 1
+ * for the first row, which is out of range) marks "no solution".
+ *
+ * A stream starts with an 8 byte header: the magic "SDKP", a version byte,
+ * and a byte saying which records follow (PACK_PUZZLE, PACK_SOLUTION or
+ * both).  After that, the records are just concatenated: for each entry, the
+ * packed puzzle first if present, then the packed solution if present.  All
+ * records have a fixed size, so a stream can also be seeked by index.
+ */
+
+#include <string.h>
+#include "sudoku_pack.h"
+
+#define PACK_VERSION 1
+
+static const char pack_magic[4] = {'S', 'D', 'K', 'P'};
+
+/** nibble value to puzzle character */
+static const char nibble_chars[16] = {
+    '.', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+    '.', '.', '.', '.', '.', '.'
+};
+
+/** (8 - i)! for the Lehmer code of a 9 element permutation */
+static const unsigned long factorials[9] = {
+    40320, 5040, 720, 120, 24, 6, 2, 1, 1
+};
+
+/** @return number of set bits in a 9 bit mask */
+static int popcount9(unsigned int m)
+{
+    m = m - ((m >> 1) & 0x155);
+    m = (m & 0x133) + ((m >> 2) & 0x133);
+    m = (m + (m >> 4)) & 0x10f;
+    return (m + (m >> 8)) & 0x1f;
+}
+
+/** @return cell value 1 - 9, or 0 for any other character */
+static unsigned int cell_value(int c)
+{
+    unsigned int d = (unsigned char) c - '0';
+    return d - 1 < 9 ? d : 0;
+}
+
+/** @brief pack 81 char puzzle into PACKED_PUZZLE_SIZE bytes */
+void pack_puzzle(unsigned char out[], const char *puzzle)
+{
+    int i;
+    for (i = 0; i < 80; i += 2)
+        out[i / 2] = cell_value(puzzle[i]) | cell_value(puzzle[i + 1]) << 4;
+    out[40] = cell_value(puzzle[80]);
+}
+
+/**
+ * @brief unpack PACKED_PUZZLE_SIZE bytes into an 81 char puzzle with '.'
+ * for blanks
+ * @param puzzle    must have room for 82 char: 81 + null terminator
+ */
+void unpack_puzzle(char *puzzle, const unsigned char in[])
+{
+    int i;
+    for (i = 0; i < 80; i += 2) {
+        puzzle[i]     = nibble_chars[in[i / 2] & 0xf];
+        puzzle[i + 1] = nibble_chars[in[i / 2] >> 4];
+    }
+    puzzle[80] = nibble_chars[in[40] & 0xf];
+    puzzle[81] = '\0';
+}
+
+/**
+ * @brief rank the permutation of 1 - 9 in row[0..8]
+ * @return rank, or -1 if row is not a permutation of '1' - '9'
+ */
+static long rank_row(const char *row)
+{
+    unsigned int unused = 0x1ff;    /* bit d - 1 set if d not seen yet */
+    unsigned int d, bit;
+    unsigned long rank = 0;
+    int i;
+
+    for (i = 0; i < 9; i++) {
+        if ((d = cell_value(row[i])) == 0)
+            return -1;
+        bit = 1u << (d - 1);
+        if (!(unused & bit))
+            return -1;
+        rank += popcount9(unused & (bit - 1)) * factorials[i];
+        unused &= ~bit;
+    }
+    return rank;
+}
+
+/** @brief inverse of rank_row; rank must be below 9! */
+static void unrank_row(char *row, unsigned long rank)
+{
+    unsigned int unused = 0x1ff;
+    unsigned int q, bit;
+    int i;
+
+    for (i = 0; i < 9; i++) {
+        q = rank / factorials[i];
+        rank %= factorials[i];
+        /* pick the q-th lowest unused digit */
+        for (bit = 1; !(unused & bit) || q-- > 0; bit <<= 1)
+            ;
+        unused &= ~bit;
+        row[i] = '1' + popcount9(bit - 1);
+    }
+}
+
+/**
+ * @brief pack an 81 char solved grid into PACKED_SOLUTION_SIZE bytes.
+ * @return 0 on success, -1 if solution is not a complete grid whose rows and
+ *         columns are all permutations (out is untouched in that case)
+ */
+int pack_solution(unsigned char out[], const char *solution)
+{
+    long ranks[8];
+    unsigned long acc = 0;
+    int i, c, nbits = 0, k = 0;
+    unsigned int col;
+
+    for (i = 0; i < 8; i++)
+        if ((ranks[i] = rank_row(solution + 9 * i)) < 0)
+            return -1;
+    if (rank_row(solution + 72) < 0)
+        return -1;
+    for (c = 0; c < 9; c++) {
+        col = 0;
+        for (i = 0; i < 9; i++)
+            col |= 1u << (cell_value(solution[9 * i + c]) - 1);
+        if (col != 0x1ff)
+            return -1;
+    }
+
+    for (i = 0; i < 8; i++) {
+        acc |= (unsigned long) ranks[i] << nbits;
+        for (nbits += 19; nbits >= 8; nbits -= 8, acc >>= 8)
+            out[k++] = acc & 0xff;
+    }
+    return 0;
+}
+
+/**
+ * @brief unpack PACKED_SOLUTION_SIZE bytes into an 81 char grid.
+ * @param solution  must have room for 82 char: 81 + null terminator
+ * @return 0 on success, -1 if the record is the "no solution" marker or is
+ *         otherwise not a valid packed solution
+ */
+int unpack_solution(char *solution, const unsigned char in[])
+{
+    unsigned long acc = 0, rank;
+    unsigned int col;
+    int i, c, nbits = 0, k = 0;
+
+    for (i = 0; i < 8; i++) {
+        for (; nbits < 19; nbits += 8)
+            acc |= (unsigned long) in[k++] << nbits;
+        rank = acc & 0x7ffff;
+        acc >>= 19;
+        nbits -= 19;
+        if (rank >= 362880)
+            return -1;
+        unrank_row(solution + 9 * i, rank);
+    }
+
+    /* last row: the digit missing from each column */
+    for (c = 0; c < 9; c++) {
+        col = 0x1ff;
+        for (i = 0; i < 8; i++)
+            col &= ~(1u << (solution[9 * i + c] - '1'));
+        if (popcount9(col) != 1)
+            return -1;
+        solution[72 + c] = '1' + popcount9(col - 1);
+    }
+    solution[81] = '\0';
+    return 0;
+}
+
+/** @brief fill out with the "no solution" marker */
+void pack_no_solution(unsigned char out[])
+{
+    memset(out, 0xff, PACKED_SOLUTION_SIZE);
+}
+
+/**
+ * @brief write a stream header for records of the given kind
+ * @return 0 on success, -1 on write error
+ */
+int pack_write_header(FILE *f, int kind)
+{
+    unsigned char h[PACKED_HEADER_SIZE];
+
+    memcpy(h, pack_magic, 4);
+    h[4] = PACK_VERSION;
+    h[5] = kind;
+    h[6] = h[7] = 0;
+    return fwrite(h, sizeof(h), 1, f) == 1 ? 0 : -1;
+}
+
+/** @return record kind from the stream header, or -1 if it is not valid */
+int pack_read_header(FILE *f)
+{
+    unsigned char h[PACKED_HEADER_SIZE];
+
+    if (fread(h, sizeof(h), 1, f) != 1 || memcmp(h, pack_magic, 4) != 0
+            || h[4] != PACK_VERSION
+            || (h[5] & (PACK_PUZZLE | PACK_SOLUTION)) == 0)
+        return -1;
+    return h[5];
+}
+
+/**
+ * @brief write one entry; puzzle and solution are only used if kind includes
+ * them, and a NULL solution is written as "no solution".
+ * @return 0 on success, -1 on write error
+ */
+int pack_write(FILE *f, int kind, const char *puzzle, const char *solution)
+{
+    unsigned char buf[PACKED_PUZZLE_SIZE + PACKED_SOLUTION_SIZE];
+    size_t n = 0;
+
+    if (kind & PACK_PUZZLE) {
+        pack_puzzle(buf, puzzle);
+        n += PACKED_PUZZLE_SIZE;
+    }
+    if (kind & PACK_SOLUTION) {
+        if (solution == NULL || pack_solution(buf + n, solution) != 0)
+            pack_no_solution(buf + n);
+        n += PACKED_SOLUTION_SIZE;
+    }
+    return fwrite(buf, n, 1, f) == 1 ? 0 : -1;
+}
+
+/**
+ * @brief read one entry written by pack_write
+ * @param solution  set to an empty string if the entry has no solution
+ * @return 1 on success, 0 at end of stream, -1 on a short or invalid record
+ */
+int pack_read(FILE *f, int kind, char *puzzle, char *solution)
+{
+    unsigned char buf[PACKED_PUZZLE_SIZE + PACKED_SOLUTION_SIZE];
+    size_t n = 0, r;
+
+    if (kind & PACK_PUZZLE)
+        n += PACKED_PUZZLE_SIZE;
+    if (kind & PACK_SOLUTION)
+        n += PACKED_SOLUTION_SIZE;
+
+    if ((r = fread(buf, 1, n, f)) != n)
+        return r == 0 ? 0 : -1;
+
+    n = 0;
+    if (kind & PACK_PUZZLE) {
+        unpack_puzzle(puzzle, buf);
+        n += PACKED_PUZZLE_SIZE;
+    }
+    if ((kind & PACK_SOLUTION) && unpack_solution(solution, buf + n) != 0)
+        solution[0] = '\0';
+    return 1;
+}
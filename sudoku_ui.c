@@ -18,6 +18,8 @@ static const char str_help[] = "Keys\n"
 "move: hjkl; numbers: 1-9; erase: 0,<space>; " "clear: c; undo: u;\n"
 "fix givens: f; solve: s; hint: H;\n"
 "^L: clear screen; quit: q.";
+/* indexed by constraint_type */
+static const char *const str_units[] = {"cell", "row", "column", "box"};
 static const char str_not_unique[] = "Warning: the current puzzle has multiple solutions.\n"
 "Hints will be disabled.";
 
@@ -91,8 +93,9 @@ static void clear_msg(void)
 int main(int argc, char *argv[])
 {
     char         puzzle[82];
+    char         solution[82];
     sudoku_hint  hints[81];
-    sudoku_hint  *hint;
+    SudokuHint   hint;
     int         hint_cells[9];
     int ch;     /* getch */
     int i, t;   /* temp */
@@ -160,15 +163,24 @@ int main(int argc, char *argv[])
             case '7':
             case '8':
             case '9':
+                t = board.conflicts;
                 set_value(&board, cr, cc, ch);
-                draw_cell(&ncboard, cr, cc);
+                /* collisions elsewhere on the board may come or go */
+                if (t != board.conflicts)
+                    draw_board(&ncboard);
+                else
+                    draw_cell(&ncboard, cr, cc);
                 break;
             case ' ':
             case 'd':
             case 0x08: /* ^H */
             case KEY_BACKSPACE:
+                t = board.conflicts;
                 set_value(&board, cr, cc, ' ');     /* erase */
-                draw_cell(&ncboard, cr, cc);
+                if (t != board.conflicts)
+                    draw_board(&ncboard);
+                else
+                    draw_cell(&ncboard, cr, cc);
                 break;
             case 'c':
                 unhighlight_all(&ncboard);
@@ -189,6 +201,12 @@ int main(int argc, char *argv[])
                             print_msg("%s", str_not_unique);
                             flags |= ERROR_BIT;
                             flags |= HINTS_DISABLED;
+                        } else { /* keep it to check entries against */
+                            for (i = 0; i < 81; i++) {
+                                hint2rcn(hints + i, &r, &c, &n);
+                                solution[(r - 1) * 9 + c - 1] = '0' + n;
+                            }
+                            set_solution(&board, solution);
                         }
                     }
                 } else {
@@ -198,11 +216,15 @@ int main(int argc, char *argv[])
                 /* toggle_fix_mode (un)bolds every char so refresh needed */
                 draw_board(&ncboard);
                 break;
-            case 'u': t = undo_board(&board);   /* only works in fixed mode */
+            case 'u': n = board.conflicts;
+                t = undo_board(&board);   /* only works in fixed mode */
                 if (t >= 0) {
                     cr = t / 9 + 1;
                     cc = t % 9 + 1;
-                    draw_cell(&ncboard, cr, cc);
+                    if (n != board.conflicts)
+                        draw_board(&ncboard);
+                    else
+                        draw_cell(&ncboard, cr, cc);
                 }
                 break;
             case 's':   /* solve puzzle if in fixed mode */
@@ -228,21 +250,40 @@ int main(int argc, char *argv[])
                 if (flags & HINTS_DISABLED)
                     break;
                 unhighlight_all(&ncboard);
-                get_values(&board, puzzle);
-                hint = next_hint(hints, puzzle);
-                if (hint - hints == 81)
+                if (board.wrong > 0) {  /* no hint leads on from these */
+                    for (r = 1; r < 9 + 1; r++)
+                        for (c = 1; c < 9 + 1; c++)
+                            if (is_cell_wrong(&board, r, c))
+                                highlight_cell(&ncboard, r, c);
+                    print_msg("Mistake: the highlighted entries are wrong; "
+                            "press 'u' to undo");
+                    flags |= ERROR_BIT;
+                    draw_board(&ncboard);
+                    break;
+                }
+                n = find_hint(&board, &hint);
+                if (n == 0) {
+                    print_msg("Hint: no single left, time to look harder");
+                    flags |= ERROR_BIT;
                     break;
-                t = hint2cells(hint, hint_cells);
+                }
+                t = hint_unit_cells(&hint, hint_cells);
                 for (i = 0; i < t; i++) {
                     c = hint_cells[i];
                     r = c / 9 + 1;
                     c = c % 9 + 1;
                     highlight_cell(&ncboard, r, c);
                 }
-                if (t > 1) {
-                    hint2rcn(hint, &r, &c, &n);
-                    print_msg("Hint: try a %d in the highlighted cells", n);
-                }
+                if (n < 0 && hint.unit < 0)
+                    print_msg("Mistake: no digit fits the highlighted cell");
+                else if (n < 0)
+                    print_msg("Mistake: no %c fits in the highlighted %s",
+                            hint.val, str_units[hint.technique]);
+                else if (hint.unit >= 0)
+                    print_msg("Hint: the highlighted %s has one place left "
+                            "for a %c", str_units[hint.technique], hint.val);
+                if (n < 0)
+                    flags |= ERROR_BIT;
                 draw_board(&ncboard);
                 break;
         }